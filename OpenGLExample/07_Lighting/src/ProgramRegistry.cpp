@@ -0,0 +1,301 @@
+#include "ProgramRegistry.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <glm/gtc/type_ptr.hpp>
+
+//64-bit FNV-1a
+static uint64_t hashString(const std::string& str, uint64_t hash = 14695981039346656037ull)
+{
+    for (unsigned char c : str) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static bool readFile(const char* path, std::string& source)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    source = stream.str();
+    return true;
+}
+
+static const char* getStageName(GLenum type)
+{
+    return type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT";
+}
+
+//Separable vertex stages have to redeclare gl_PerVertex to be matched against other programs
+static std::string makeSeparable(GLenum type, const std::string& source)
+{
+    if (type != GL_VERTEX_SHADER || source.find("gl_PerVertex") != std::string::npos)
+        return source;
+
+    size_t versionPos = source.find("#version");
+    if (versionPos == std::string::npos)
+        return source;
+    size_t lineEnd = source.find('\n', versionPos);
+    if (lineEnd == std::string::npos)
+        return source;
+
+    //Count lines up to the #version directive so #line keeps error messages pointing at the file
+    int nextLine = 2;
+    for (size_t i = 0; i < versionPos; i++) {
+        if (source[i] == '\n')
+            nextLine++;
+    }
+
+    std::string result = source.substr(0, lineEnd + 1);
+    result += "#extension GL_ARB_separate_shader_objects : enable\n";
+    result += "out gl_PerVertex { vec4 gl_Position; };\n";
+    result += "#line " + std::to_string(nextLine) + "\n";
+    result += source.substr(lineEnd + 1);
+    return result;
+}
+
+ProgramRegistry::ProgramRegistry()
+{
+    m_separable = GLEW_ARB_separate_shader_objects != 0;
+}
+
+ProgramRegistry::~ProgramRegistry()
+{
+    for (auto& pipeline : m_pipelines) {
+        if (pipeline.second->m_pipeline)
+            glDeleteProgramPipelines(1, &pipeline.second->m_pipeline);
+        else
+            glDeleteProgram(pipeline.second->m_programs[0]);
+    }
+    for (auto& stage : m_stages) {
+        if (m_separable)
+            glDeleteProgram(stage.second);
+        else
+            glDeleteShader(stage.second);
+    }
+}
+
+ShaderPipeline& ProgramRegistry::Get(const char* vertexPath, const char* fragmentPath)
+{
+    unsigned int vertexStage = getStage(GL_VERTEX_SHADER, vertexPath);
+    unsigned int fragmentStage = getStage(GL_FRAGMENT_SHADER, fragmentPath);
+
+    std::string key = std::to_string(vertexStage) + ":" + std::to_string(fragmentStage);
+    auto it = m_pipelines.find(key);
+    if (it != m_pipelines.end())
+        return *it->second;
+
+    std::unique_ptr<ShaderPipeline> pipeline(new ShaderPipeline());
+    if (m_separable) {
+        glGenProgramPipelines(1, &pipeline->m_pipeline);
+        glUseProgramStages(pipeline->m_pipeline, GL_VERTEX_SHADER_BIT, vertexStage);
+        glUseProgramStages(pipeline->m_pipeline, GL_FRAGMENT_SHADER_BIT, fragmentStage);
+        pipeline->m_programs[0] = vertexStage;
+        pipeline->m_programs[1] = fragmentStage;
+
+        glValidateProgramPipeline(pipeline->m_pipeline);
+        int success;
+        glGetProgramPipelineiv(pipeline->m_pipeline, GL_VALIDATE_STATUS, &success);
+        if (!success)
+        {
+            char infoLog[512];
+            glGetProgramPipelineInfoLog(pipeline->m_pipeline, 512, NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_REGISTRY::PIPELINE::VALIDATION_FAILED " << vertexPath << " + " << fragmentPath << "\n" << infoLog << std::endl;
+        }
+    }
+    else {
+        //Fallback: link the shared shader objects into a regular program
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, vertexStage);
+        glAttachShader(program, fragmentStage);
+        glLinkProgram(program);
+        glDetachShader(program, vertexStage);
+        glDetachShader(program, fragmentStage);
+
+        int success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            char infoLog[512];
+            glGetProgramInfoLog(program, 512, NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_REGISTRY::PROGRAM::LINKING_FAILED " << vertexPath << " + " << fragmentPath << "\n" << infoLog << std::endl;
+        }
+        pipeline->m_programs[0] = program;
+        pipeline->m_programs[1] = program;
+    }
+
+    ShaderPipeline& result = *pipeline;
+    m_pipelines[key] = std::move(pipeline);
+    return result;
+}
+
+unsigned int ProgramRegistry::getStage(GLenum type, const char* path)
+{
+    std::string source;
+    if (!readFile(path, source))
+        std::cout << "ERROR::PROGRAM_REGISTRY::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+
+    //The stage type is part of the key so identical text compiled as two stages stays separate
+    uint64_t hash = hashString(source, hashString(getStageName(type)));
+    auto it = m_stages.find(hash);
+    if (it != m_stages.end()) {
+        m_sharedStages++;
+        return it->second;
+    }
+
+    unsigned int stage = m_separable ? compileSeparable(type, source, path) : compileShader(type, source, path);
+    m_stages[hash] = stage;
+    return stage;
+}
+
+unsigned int ProgramRegistry::compileSeparable(GLenum type, const std::string& source, const char* path)
+{
+    std::string code = makeSeparable(type, source);
+    const char* codePtr = code.c_str();
+    //Compiles, sets GL_PROGRAM_SEPARABLE and links in one call
+    unsigned int program = glCreateShaderProgramv(type, 1, &codePtr);
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        char infoLog[512];
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        std::cout << "ERROR::PROGRAM_REGISTRY::" << getStageName(type) << "::COMPILATION_FAILED " << path << "\n" << infoLog << std::endl;
+    }
+    return program;
+}
+
+unsigned int ProgramRegistry::compileShader(GLenum type, const std::string& source, const char* path)
+{
+    const char* codePtr = source.c_str();
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &codePtr, NULL);
+    glCompileShader(shader);
+
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cout << "ERROR::PROGRAM_REGISTRY::" << getStageName(type) << "::COMPILATION_FAILED " << path << "\n" << infoLog << std::endl;
+    }
+    return shader;
+}
+
+void ShaderPipeline::use()
+{
+    if (m_pipeline) {
+        //A program bound with glUseProgram takes precedence over the pipeline
+        glUseProgram(0);
+        glBindProgramPipeline(m_pipeline);
+    }
+    else {
+        glUseProgram(m_programs[0]);
+    }
+}
+
+int ShaderPipeline::getStageCount() const
+{
+    return m_pipeline ? NUM_STAGES : 1;
+}
+
+int ShaderPipeline::getUniformLocation(int stage, const std::string& name) const
+{
+    auto it = m_locations[stage].find(name);
+    if (it != m_locations[stage].end())
+        return it->second;
+    int location = glGetUniformLocation(m_programs[stage], name.c_str());
+    m_locations[stage][name] = location;
+    return location;
+}
+
+void ShaderPipeline::setBool(const std::string& name, bool value) const
+{
+    setInt(name, (int)value);
+}
+
+void ShaderPipeline::setInt(const std::string& name, int value) const
+{
+    for (int i = 0; i < getStageCount(); i++) {
+        int location = getUniformLocation(i, name);
+        if (location == -1)
+            continue;
+        if (m_pipeline)
+            glProgramUniform1i(m_programs[i], location, value);
+        else
+            glUniform1i(location, value);
+    }
+}
+
+void ShaderPipeline::setFloat(const std::string& name, float value) const
+{
+    for (int i = 0; i < getStageCount(); i++) {
+        int location = getUniformLocation(i, name);
+        if (location == -1)
+            continue;
+        if (m_pipeline)
+            glProgramUniform1f(m_programs[i], location, value);
+        else
+            glUniform1f(location, value);
+    }
+}
+
+void ShaderPipeline::setVec2(const std::string& name, const glm::vec2& value) const
+{
+    for (int i = 0; i < getStageCount(); i++) {
+        int location = getUniformLocation(i, name);
+        if (location == -1)
+            continue;
+        if (m_pipeline)
+            glProgramUniform2f(m_programs[i], location, value.x, value.y);
+        else
+            glUniform2f(location, value.x, value.y);
+    }
+}
+
+void ShaderPipeline::setVec3(const std::string& name, const glm::vec3& value) const
+{
+    for (int i = 0; i < getStageCount(); i++) {
+        int location = getUniformLocation(i, name);
+        if (location == -1)
+            continue;
+        if (m_pipeline)
+            glProgramUniform3f(m_programs[i], location, value.x, value.y, value.z);
+        else
+            glUniform3f(location, value.x, value.y, value.z);
+    }
+}
+
+void ShaderPipeline::setVec4(const std::string& name, const glm::vec4& value) const
+{
+    for (int i = 0; i < getStageCount(); i++) {
+        int location = getUniformLocation(i, name);
+        if (location == -1)
+            continue;
+        if (m_pipeline)
+            glProgramUniform4f(m_programs[i], location, value.x, value.y, value.z, value.w);
+        else
+            glUniform4f(location, value.x, value.y, value.z, value.w);
+    }
+}
+
+void ShaderPipeline::setMat4(const std::string& name, const glm::mat4& mat) const
+{
+    for (int i = 0; i < getStageCount(); i++) {
+        int location = getUniformLocation(i, name);
+        if (location == -1)
+            continue;
+        if (m_pipeline)
+            glProgramUniformMatrix4fv(m_programs[i], location, 1, GL_FALSE, glm::value_ptr(mat));
+        else
+            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+    }
+}
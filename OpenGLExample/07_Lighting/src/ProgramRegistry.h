@@ -0,0 +1,84 @@
+#pragma once
+#ifndef PROGRAM_REGISTRY_H
+#define PROGRAM_REGISTRY_H
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+/// <summary>
+/// A vertex + fragment stage combination handed out by ProgramRegistry.
+/// Exposes the same setters as Shader so it can be used as a drop-in replacement.
+/// </summary>
+class ShaderPipeline
+{
+public:
+    //Bind the pipeline (or the linked fallback program)
+    void use();
+    //Uniform setters, applied to every stage that declares the uniform
+    void setBool(const std::string& name, bool value) const;
+    void setInt(const std::string& name, int value) const;
+    void setFloat(const std::string& name, float value) const;
+    void setVec2(const std::string& name, const glm::vec2& value) const;
+    void setVec3(const std::string& name, const glm::vec3& value) const;
+    void setVec4(const std::string& name, const glm::vec4& value) const;
+    void setMat4(const std::string& name, const glm::mat4& mat) const;
+private:
+    friend class ProgramRegistry;
+    static const int NUM_STAGES = 2;
+
+    //Program pipeline object, 0 when running on the fallback path
+    unsigned int m_pipeline = 0;
+    //Separable program per stage, or the single linked program (in both slots) on the fallback path
+    unsigned int m_programs[NUM_STAGES] = { 0, 0 };
+    //Uniform locations per stage, looked up once
+    mutable std::unordered_map<std::string, int> m_locations[NUM_STAGES];
+
+    int getUniformLocation(int stage, const std::string& name) const;
+    int getStageCount() const;
+};
+
+/// <summary>
+/// Compiles every shader stage once, keyed by a hash of its source, and combines
+/// stages into pipelines at bind time through ARB_separate_shader_objects.
+/// Without the extension the deduplicated shader objects are linked into regular programs.
+/// </summary>
+class ProgramRegistry
+{
+public:
+    ProgramRegistry();
+    ~ProgramRegistry();
+    ProgramRegistry(const ProgramRegistry&) = delete;
+    ProgramRegistry& operator=(const ProgramRegistry&) = delete;
+
+    /// <summary>
+    /// Returns the pipeline for the given pair of stages, compiling any stage not seen before.
+    /// The reference stays valid for the lifetime of the registry.
+    /// </summary>
+    ShaderPipeline& Get(const char* vertexPath, const char* fragmentPath);
+
+    bool IsSeparable() const { return m_separable; }
+    //Number of unique stages that were compiled
+    size_t GetStageCount() const { return m_stages.size(); }
+    //Number of stage requests that reused an already compiled stage
+    size_t GetSharedStageCount() const { return m_sharedStages; }
+    size_t GetPipelineCount() const { return m_pipelines.size(); }
+private:
+    bool m_separable;
+    size_t m_sharedStages = 0;
+    //Source hash -> separable program (or shader object on the fallback path)
+    std::unordered_map<uint64_t, unsigned int> m_stages;
+    //"vertexStage:fragmentStage" -> pipeline
+    std::unordered_map<std::string, std::unique_ptr<ShaderPipeline>> m_pipelines;
+
+    unsigned int getStage(GLenum type, const char* path);
+    unsigned int compileSeparable(GLenum type, const std::string& source, const char* path);
+    unsigned int compileShader(GLenum type, const std::string& source, const char* path);
+};
+
+#endif
@@ -8,7 +8,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include "Shader.h"
+#include "ProgramRegistry.h"
 #include "Primitive.h"
 #include "ShapeGen.h"
 #include "FlyCamera.h"
@@ -75,8 +75,13 @@ int main()
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 
-    Shader shader = Shader("shaders/vertex.glsl", "shaders/fragment.glsl");
-    Shader lightShader = Shader("shaders/vertex.glsl", "shaders/lightFragment.glsl");
+    //Both programs share shaders/vertex.glsl, the registry compiles it once
+    ProgramRegistry* programRegistry = new ProgramRegistry();
+    ShaderPipeline& shader = programRegistry->Get("shaders/vertex.glsl", "shaders/fragment.glsl");
+    ShaderPipeline& lightShader = programRegistry->Get("shaders/vertex.glsl", "shaders/lightFragment.glsl");
+    std::cout << "Programs: " << programRegistry->GetPipelineCount() << " pipelines from "
+        << programRegistry->GetStageCount() << " compiled stages, " << programRegistry->GetSharedStageCount() << " stages reused"
+        << (programRegistry->IsSeparable() ? "" : " (separate shader objects unsupported, linked programs)") << std::endl;
 
     MeshData cubeMesh;
     generateCube(0.5f, glm::vec3(1,0,1), cubeMesh);
@@ -153,6 +158,7 @@ int main()
         glfwPollEvents();
     }
 
+    delete programRegistry;
     glfwTerminate();
     return 0;
 }
@@ -8,6 +8,7 @@ in vec2 TexCoord;
 
 //Uniforms
 uniform sampler2D mainTexture;
+uniform vec2 uvScale;
 
 const float offset = 1.0 / 200.0;
 
@@ -25,9 +26,12 @@ void main()
         1.0/16,2.0/16,1.0/16
     );
 
+    //Stay inside the drawn part, the rest of the texture is padding
+    vec2 maxCoord = uvScale - 0.5 / vec2(textureSize(mainTexture, 0));
+
     vec3 col = vec3(0.0);
     for(int i =0; i < 9; i++){
-        col+=vec3(texture(mainTexture,TexCoord.st + offsets[i])) * kernel[i];
+        col+=vec3(texture(mainTexture,min(TexCoord.st + offsets[i], maxCoord))) * kernel[i];
     }
     FragColor = vec4(col,1.0);
 }
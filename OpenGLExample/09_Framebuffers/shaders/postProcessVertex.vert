@@ -5,13 +5,14 @@ layout (location = 0) in vec3 aPos; //Position
 layout (location = 1) in vec2 aTexCoord; //Tex coord
 
 //Uniforms
+uniform vec2 uvScale; //Part of the texture that was drawn into, see RenderTarget::getUVScale
 
 //Passed to fragment shader
 out vec2 TexCoord;
 
 void main()
 {
-    TexCoord = aTexCoord;
+    TexCoord = aTexCoord * uvScale;
     gl_Position = vec4(aPos,1.0);
 }
 
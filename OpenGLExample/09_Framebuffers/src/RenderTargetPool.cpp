@@ -0,0 +1,189 @@
+#include "RenderTargetPool.h"
+
+#include <iostream>
+
+RenderTargetPool::RenderTargetPool(size_t budgetBytes) : m_budget(budgetBytes)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    while (!m_entries.empty())
+        destroy(m_entries.size() - 1);
+}
+
+void RenderTargetPool::BeginFrame()
+{
+    m_frame++;
+    for (size_t i = m_entries.size(); i-- > 0;) {
+        Entry& entry = *m_entries[i];
+        entry.inUse = false;
+        //Sizes left behind by a resize, or passes that were turned off
+        if (m_frame - entry.lastUsedFrame > EVICT_FRAMES) {
+            destroy(i);
+            m_evictions++;
+        }
+    }
+}
+
+RenderTarget* RenderTargetPool::Acquire(const RenderTargetDesc& desc)
+{
+    int allocatedWidth = roundUp(desc.width);
+    int allocatedHeight = roundUp(desc.height);
+
+    Entry* found = nullptr;
+    for (auto& entry : m_entries) {
+        if (!entry->inUse && entry->target.allocatedWidth == allocatedWidth && entry->target.allocatedHeight == allocatedHeight
+            && entry->colorFormat == desc.colorFormat && entry->depthFormat == desc.depthFormat && entry->samples == desc.samples) {
+            found = entry.get();
+            break;
+        }
+    }
+    if (found == nullptr)
+        found = create(desc, allocatedWidth, allocatedHeight);
+
+    found->inUse = true;
+    found->lastUsedFrame = m_frame;
+    found->target.width = desc.width;
+    found->target.height = desc.height;
+    return &found->target;
+}
+
+void RenderTargetPool::Release(RenderTarget* target)
+{
+    for (auto& entry : m_entries) {
+        if (&entry->target == target) {
+            entry->inUse = false;
+            return;
+        }
+    }
+}
+
+RenderTargetPool::Entry* RenderTargetPool::create(const RenderTargetDesc& desc, int allocatedWidth, int allocatedHeight)
+{
+    int samples = desc.samples > 0 ? desc.samples : 1;
+    size_t bytes = (size_t)allocatedWidth * allocatedHeight * samples
+        * (getBytesPerPixel(desc.colorFormat) + getBytesPerPixel(desc.depthFormat));
+    makeRoom(bytes);
+    if (m_allocatedBytes + bytes > m_budget)
+        std::cout << "ERROR::RENDER_TARGET_POOL::OVER_BUDGET\n" << (m_allocatedBytes + bytes) / (1024 * 1024) << " MB of "
+            << m_budget / (1024 * 1024) << " MB in use" << std::endl;
+
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->colorFormat = desc.colorFormat;
+    entry->depthFormat = desc.depthFormat;
+    entry->samples = desc.samples;
+    entry->bytes = bytes;
+    entry->inUse = false;
+    entry->lastUsedFrame = m_frame;
+
+    RenderTarget& target = entry->target;
+    target = {};
+    target.allocatedWidth = allocatedWidth;
+    target.allocatedHeight = allocatedHeight;
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+
+    if (desc.colorFormat == GL_NONE) {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    else if (desc.samples > 0) {
+        glGenRenderbuffers(1, &target.colorRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, target.colorRenderbuffer);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, desc.samples, desc.colorFormat, allocatedWidth, allocatedHeight);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.colorRenderbuffer);
+    }
+    else {
+        glGenTextures(1, &target.colorTexture);
+        glBindTexture(GL_TEXTURE_2D, target.colorTexture);
+        //Data format only matters when uploading, nothing is uploaded here
+        glTexImage2D(GL_TEXTURE_2D, 0, desc.colorFormat, allocatedWidth, allocatedHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.colorTexture, 0);
+    }
+
+    if (desc.depthFormat != GL_NONE) {
+        //Using an RBO is faster when the depth buffer is never sampled
+        glGenRenderbuffers(1, &target.depthRenderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, target.depthRenderbuffer);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, desc.samples, desc.depthFormat, allocatedWidth, allocatedHeight);
+        GLenum attachment = desc.depthFormat == GL_DEPTH24_STENCIL8 || desc.depthFormat == GL_DEPTH32F_STENCIL8
+            ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, target.depthRenderbuffer);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::RENDER_TARGET_POOL::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_allocatedBytes += bytes;
+    m_allocations++;
+    m_entries.push_back(std::move(entry));
+    return m_entries.back().get();
+}
+
+void RenderTargetPool::destroy(size_t index)
+{
+    RenderTarget& target = m_entries[index]->target;
+    glDeleteFramebuffers(1, &target.framebuffer);
+    if (target.colorTexture)
+        glDeleteTextures(1, &target.colorTexture);
+    if (target.colorRenderbuffer)
+        glDeleteRenderbuffers(1, &target.colorRenderbuffer);
+    if (target.depthRenderbuffer)
+        glDeleteRenderbuffers(1, &target.depthRenderbuffer);
+    m_allocatedBytes -= m_entries[index]->bytes;
+    m_entries.erase(m_entries.begin() + index);
+}
+
+void RenderTargetPool::makeRoom(size_t bytes)
+{
+    while (m_allocatedBytes + bytes > m_budget) {
+        size_t oldest = m_entries.size();
+        for (size_t i = 0; i < m_entries.size(); i++) {
+            if (!m_entries[i]->inUse && (oldest == m_entries.size() || m_entries[i]->lastUsedFrame < m_entries[oldest]->lastUsedFrame))
+                oldest = i;
+        }
+        //Everything left is in use this frame
+        if (oldest == m_entries.size())
+            return;
+        destroy(oldest);
+        m_evictions++;
+    }
+}
+
+int RenderTargetPool::roundUp(int size)
+{
+    if (size < 1)
+        size = 1;
+    return (size + SIZE_GRANULARITY - 1) / SIZE_GRANULARITY * SIZE_GRANULARITY;
+}
+
+size_t RenderTargetPool::getBytesPerPixel(GLenum format)
+{
+    switch (format) {
+    case GL_NONE:
+        return 0;
+    case GL_R8:
+        return 1;
+    case GL_RG8:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+        return 2;
+    case GL_RGBA16F:
+    case GL_RG32F:
+    case GL_DEPTH32F_STENCIL8:
+        return 8;
+    case GL_RGBA32F:
+        return 16;
+    default:
+        //RGB8 is padded to 4 bytes by most drivers, like the 24 bit depth formats
+        return 4;
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+#ifndef RENDER_TARGET_POOL_H
+#define RENDER_TARGET_POOL_H
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/// <summary>
+/// What a render target is requested with. GL_NONE leaves out the color or depth attachment.
+/// With samples above 0 both attachments are multisampled renderbuffers, to be resolved with glBlitFramebuffer.
+/// Otherwise color is a texture that can be sampled
+/// </summary>
+struct RenderTargetDesc
+{
+    int width;
+    int height;
+    GLenum colorFormat;
+    GLenum depthFormat;
+    int samples;
+};
+
+/// <summary>
+/// Framebuffer and attachments handed out by RenderTargetPool.
+/// Attachments are allocated rounded up, so only the bottom left width x height is drawn into
+/// </summary>
+struct RenderTarget
+{
+    unsigned int framebuffer;
+    //0 when multisampled
+    unsigned int colorTexture;
+    //Only when multisampled
+    unsigned int colorRenderbuffer;
+    unsigned int depthRenderbuffer;
+    //Size requested by the current user, set the viewport to it
+    int width;
+    int height;
+    int allocatedWidth;
+    int allocatedHeight;
+
+    //Multiply texture coordinates by this to sample only the drawn part of colorTexture
+    glm::vec2 getUVScale() const { return glm::vec2((float)width / allocatedWidth, (float)height / allocatedHeight); }
+};
+
+/// <summary>
+/// Reuses framebuffers between frames and between passes of a frame, keyed by size, formats and sample count.
+/// Sizes are rounded up to SIZE_GRANULARITY, so resizing the window only allocates when it crosses a step.
+/// Targets nobody acquired for EVICT_FRAMES frames are deleted, and older free ones go first whenever
+/// a new allocation would exceed the memory budget.
+/// </summary>
+class RenderTargetPool
+{
+public:
+    static const int SIZE_GRANULARITY = 128;
+    static const unsigned int EVICT_FRAMES = 120;
+
+    explicit RenderTargetPool(size_t budgetBytes);
+    ~RenderTargetPool();
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    //Reclaims every target still acquired and deletes the ones unused for too long
+    void BeginFrame();
+    /// <summary>
+    /// Returns a free target matching desc, allocating one if there is none.
+    /// Valid until released or until the next BeginFrame
+    /// </summary>
+    RenderTarget* Acquire(const RenderTargetDesc& desc);
+    //Hands the target back so a later pass this frame can reuse it
+    void Release(RenderTarget* target);
+
+    //Bytes the attachments of all pooled targets take, estimated from their formats
+    size_t GetAllocatedBytes() const { return m_allocatedBytes; }
+    size_t GetBudget() const { return m_budget; }
+    size_t GetTargetCount() const { return m_entries.size(); }
+    //Targets created and deleted since the pool was created
+    size_t GetAllocationCount() const { return m_allocations; }
+    size_t GetEvictionCount() const { return m_evictions; }
+private:
+    struct Entry
+    {
+        RenderTarget target;
+        GLenum colorFormat;
+        GLenum depthFormat;
+        int samples;
+        size_t bytes;
+        bool inUse;
+        unsigned int lastUsedFrame;
+    };
+
+    size_t m_budget;
+    size_t m_allocatedBytes = 0;
+    size_t m_allocations = 0;
+    size_t m_evictions = 0;
+    unsigned int m_frame = 0;
+    std::vector<std::unique_ptr<Entry>> m_entries;
+
+    Entry* create(const RenderTargetDesc& desc, int allocatedWidth, int allocatedHeight);
+    void destroy(size_t index);
+    //Deletes free targets, least recently used first, until bytes more fit in the budget
+    void makeRoom(size_t bytes);
+
+    static int roundUp(int size);
+    static size_t getBytesPerPixel(GLenum format);
+};
+
+#endif
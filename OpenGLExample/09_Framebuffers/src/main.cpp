@@ -8,10 +8,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include "Shader.h"
+#include "ProgramRegistry.h"
 #include "Primitive.h"
 #include "ShapeGen.h"
 #include "OrbitCamera.h"
+#include "RenderTargetPool.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
@@ -23,6 +24,13 @@ unsigned int createFullScreenQuad();
 // settings
 const unsigned int SCR_WIDTH = 1080;
 const unsigned int SCR_HEIGHT = 720;
+//Samples of the scene target, resolved before post processing
+const int MSAA_SAMPLES = 4;
+//Memory the render targets may take before unused ones are evicted early
+const size_t RENDER_TARGET_BUDGET = 64 * 1024 * 1024;
+
+//Framebuffer size, updated on resize. Render targets follow it the next frame
+int windowWidth = SCR_WIDTH, windowHeight = SCR_HEIGHT;
 
 //Camera
 const float mouseSensitivity = 0.01f;
@@ -62,43 +70,19 @@ int main()
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetScrollCallback(window, mouse_scroll_callback);
 
-    Shader shader = Shader("shaders/vertex.glsl", "shaders/fragment.glsl");
-    Shader lightShader = Shader("shaders/vertex.glsl", "shaders/lightFragment.glsl");
-    Shader postProcessShader = Shader("shaders/postProcessVertex.vert", "shaders/postProcessBlur.frag");
-
-    //Create frame buffer object
-    unsigned int frameBuffer;
-    glGenFramebuffers(1, &frameBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-
-    //Create framebuffer texture
-    unsigned int frameBufferTexture;
-    glGenTextures(1, &frameBufferTexture);
-    glBindTexture(GL_TEXTURE_2D, frameBufferTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    //Attach texture to framebuffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frameBufferTexture, 0);
-
-    //Create RBO (render buffer object)
-    //Using an RBO is faster when reading from the buffers it is attached to
-    unsigned int rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-
-    //Attach the renderbuffer object to depth and stencil attachment of the framebuffer
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        printf("ERROR:FRAMEBUFFER:: Framebuffer is not complete!");
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    //Scene programs share shaders/vertex.glsl and post process programs their vertex stage, the registry compiles each once
+    ProgramRegistry* programRegistry = new ProgramRegistry();
+    ShaderPipeline& shader = programRegistry->Get("shaders/vertex.glsl", "shaders/fragment.glsl");
+    ShaderPipeline& lightShader = programRegistry->Get("shaders/vertex.glsl", "shaders/lightFragment.glsl");
+    ShaderPipeline& postProcessShader = programRegistry->Get("shaders/postProcessVertex.vert", "shaders/postProcessBlur.frag");
+    ShaderPipeline& presentShader = programRegistry->Get("shaders/postProcessVertex.vert", "shaders/postProcessDefault.frag");
+    std::cout << "Programs: " << programRegistry->GetPipelineCount() << " pipelines from "
+        << programRegistry->GetStageCount() << " compiled stages, " << programRegistry->GetSharedStageCount() << " stages reused"
+        << (programRegistry->IsSeparable() ? "" : " (separate shader objects unsupported, linked programs)") << std::endl;
+
+    //Scene, resolve and blur targets are taken from the pool every frame
+    RenderTargetPool* renderTargetPool = new RenderTargetPool(RENDER_TARGET_BUDGET);
+    size_t reportedAllocations = 0;
 
     int fullScreenQuad = createFullScreenQuad();
 
@@ -112,7 +96,6 @@ int main()
     Primitive cube = Primitive(&cubeMesh);
 
     camera.setAzimuth(PI / 2);
-    glm::mat4 projection = glm::perspective(camera.getFov(), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 
     //Light
     glm::vec3 lightPos = glm::vec3(0, 1, 0);
@@ -123,9 +106,18 @@ int main()
     {
         processInput(window);
 
+        //Nothing to draw while minimized
+        if (windowWidth == 0 || windowHeight == 0) {
+            glfwWaitEvents();
+            continue;
+        }
+        renderTargetPool->BeginFrame();
+        glm::mat4 projection = glm::perspective(camera.getFov(), (float)windowWidth / (float)windowHeight, 0.1f, 100.0f);
 
         //Start drawing to framebuffer
-        glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+        RenderTarget* sceneTarget = renderTargetPool->Acquire({ windowWidth, windowHeight, GL_RGBA8, GL_DEPTH24_STENCIL8, MSAA_SAMPLES });
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneTarget->framebuffer);
+        glViewport(0, 0, sceneTarget->width, sceneTarget->height);
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glEnable(GL_DEPTH_TEST);
@@ -172,24 +164,51 @@ int main()
         shader.setMat4("model", model);
         sphere.Draw();
 
+        //Resolve the samples into a texture the post process can read
+        RenderTarget* resolveTarget = renderTargetPool->Acquire({ windowWidth, windowHeight, GL_RGBA8, GL_NONE, 0 });
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneTarget->framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolveTarget->framebuffer);
+        glBlitFramebuffer(0, 0, windowWidth, windowHeight, 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        renderTargetPool->Release(sceneTarget);
+
+        //Blur into a second target of the same kind
+        RenderTarget* blurTarget = renderTargetPool->Acquire({ windowWidth, windowHeight, GL_RGBA8, GL_NONE, 0 });
+        glBindFramebuffer(GL_FRAMEBUFFER, blurTarget->framebuffer);
+        glDisable(GL_DEPTH_TEST);
+        glBindVertexArray(fullScreenQuad);
+
+        postProcessShader.use();
+        postProcessShader.setVec2("uvScale", resolveTarget->getUVScale());
+        glBindTexture(GL_TEXTURE_2D, resolveTarget->colorTexture);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        renderTargetPool->Release(resolveTarget);
+
         //Draw fullscreen quad
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        postProcessShader.use();
-        glBindVertexArray(fullScreenQuad);
-
-        glDisable(GL_DEPTH_TEST);
-        glBindTexture(GL_TEXTURE_2D, frameBufferTexture);
-
+        presentShader.use();
+        presentShader.setVec2("uvScale", blurTarget->getUVScale());
+        glBindTexture(GL_TEXTURE_2D, blurTarget->colorTexture);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        renderTargetPool->Release(blurTarget);
+
+        //Resizing only allocates when the size crosses a rounding step
+        if (renderTargetPool->GetAllocationCount() != reportedAllocations) {
+            reportedAllocations = renderTargetPool->GetAllocationCount();
+            std::cout << "Render targets: " << renderTargetPool->GetTargetCount() << " pooled, "
+                << renderTargetPool->GetAllocatedBytes() / (1024 * 1024) << " of " << RENDER_TARGET_BUDGET / (1024 * 1024) << " MB, "
+                << reportedAllocations << " allocations, " << renderTargetPool->GetEvictionCount() << " evictions" << std::endl;
+        }
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
     
+    delete renderTargetPool;
+    delete programRegistry;
     glfwTerminate();
     return 0;
 }
@@ -203,6 +222,8 @@ void processInput(GLFWwindow* window)
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    windowWidth = width;
+    windowHeight = height;
 }
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
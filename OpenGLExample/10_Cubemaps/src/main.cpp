@@ -94,6 +94,10 @@ int main()
     Shader skyboxShader = Shader("shaders/skybox.vert", "shaders/skybox.frag");
  
     GLuint skyboxVAO = createSkyboxVAO();
+    //Index count never changes, so query it once while the skybox VAO (and its EBO) is still bound
+    int skyboxIndexBufferSize;
+    glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &skyboxIndexBufferSize);
+    GLsizei skyboxIndexCount = skyboxIndexBufferSize / sizeof(GLushort);
 
     Shader cubeShader = Shader("shaders/defaultCube.vert", "shaders/defaultCube.frag");
     GLuint cubeTexture = loadTexture("textures/wall.jpg");
@@ -156,10 +160,7 @@ int main()
             skyboxShader.setMat4("u_projection", camera.GetProjectionMatrix());
 
             glBindVertexArray(skyboxVAO);
-
-            int size;
-            glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-            glDrawElements(GL_TRIANGLES, size / sizeof(GLushort), GL_UNSIGNED_SHORT, 0);
+            glDrawElements(GL_TRIANGLES, skyboxIndexCount, GL_UNSIGNED_SHORT, 0);
         }
 
         glfwSwapBuffers(window);
@@ -0,0 +1,10 @@
+//Per-frame constants. Layout must match FrameData in UniformBlocks.h
+layout (std140) uniform FrameData
+{
+    mat4 u_projection;
+    mat4 u_view;
+    mat4 u_lightSpaceMatrix;
+    vec3 u_cameraPos;
+    vec3 u_lightPos;
+    vec3 u_lightColor;
+};
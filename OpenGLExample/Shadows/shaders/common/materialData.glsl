@@ -0,0 +1,11 @@
+//Per-material constants. Layout must match MaterialData in UniformBlocks.h
+layout (std140) uniform MaterialData
+{
+    vec2 u_tile;
+    float u_shininess;
+    float u_reflectivity;
+    //Weights of the ambient, diffuse and specular lighting terms
+    float u_ambientK;
+    float u_diffuseK;
+    float u_specularK;
+};
\ No newline at end of file
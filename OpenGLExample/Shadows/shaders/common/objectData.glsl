@@ -0,0 +1,8 @@
+//Per-object constants. Layout must match ObjectData in UniformBlocks.h
+layout (std140) uniform ObjectData
+{
+    mat4 u_model;
+    mat4 u_normalMatrix;
+    mat4 u_mvp;
+    mat4 u_lightMvp;
+};
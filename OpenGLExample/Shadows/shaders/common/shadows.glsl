@@ -0,0 +1,42 @@
+//Shadow map lookup shared by lit shaders. Enabled with USE_SHADOWS, filtered with USE_PCF
+#ifndef PCF_RADIUS
+#define PCF_RADIUS 1
+#endif
+
+#ifdef USE_SHADOWS
+//Returns 1 if in shadow, 0 if out of shadow
+//normal and lightDir are normalized, in world space
+float calculateShadow(sampler2D shadowMap, vec4 lightSpacePos, vec3 normal, vec3 lightDir){
+    vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w;
+    projCoords = projCoords * 0.5 + 0.5;
+
+    //Depth of current fragment from light's perspective (0-1)
+    float currentDepth = projCoords.z;
+
+    float bias = max(0.01 * (1.0 - dot(normal,lightDir)),0.001);
+
+#ifdef USE_PCF
+    //PCF filtering
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    for(int x = -PCF_RADIUS; x <= PCF_RADIUS; ++x)
+    {
+        for(int y = -PCF_RADIUS; y <= PCF_RADIUS; ++y)
+        {
+            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r; 
+            shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;        
+        }    
+    }
+    shadow /= float((2 * PCF_RADIUS + 1) * (2 * PCF_RADIUS + 1));
+#else
+    //Closest depth value from light's perspective (0-1)
+    float closestDepth = texture(shadowMap,projCoords.xy).r;
+    float shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
+#endif
+    
+    // keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
+    if(projCoords.z > 1.0)
+        shadow = 0.0;
+    return shadow;
+}
+#endif
@@ -9,20 +9,21 @@ out vec3 Color;
 out vec3 Normal;
 out vec3 WorldPosition;
 out vec2 TexCoords;
+#ifdef USE_SHADOWS
 out vec4 LightSpacePosition;
+#endif
 
-uniform mat4 u_model;
-uniform mat4 u_projection;
-uniform mat4 u_view;
-uniform mat4 u_lightSpaceMatrix;
+#include "common/objectData.glsl"
 
 void main()
 {
     Color = aColor;
     WorldPosition = vec3(u_model * vec4(aPos,1.0));
-    Normal = transpose(inverse(mat3(u_model)))*aNormal;
+    Normal = mat3(u_normalMatrix) * aNormal;
 
     TexCoords = aTexCoord;
-    LightSpacePosition = u_lightSpaceMatrix * vec4(WorldPosition,1.0);
-    gl_Position = u_projection * u_view * vec4(WorldPosition, 1.0);
+#ifdef USE_SHADOWS
+    LightSpacePosition = u_lightMvp * vec4(aPos,1.0);
+#endif
+    gl_Position = u_mvp * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,6 @@
+#version 330 core
+
+//Only the depth test matters, color writes are masked off
+void main()
+{
+}
@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+#include "common/frameData.glsl"
+
+//World space box the unit cube is stretched over
+uniform vec3 u_boxCenter;
+uniform vec3 u_boxSize;
+
+void main()
+{
+    gl_Position = u_projection * u_view * vec4(u_boxCenter + aPos * u_boxSize, 1.0);
+}
@@ -1,10 +1,9 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 u_lightSpaceMatrix;
-uniform mat4 u_model;
+#include "common/objectData.glsl"
 
 void main()
 {
-    gl_Position = u_lightSpaceMatrix * u_model * vec4(aPos, 1.0);
+    gl_Position = u_lightMvp * vec4(aPos, 1.0);
 } 
\ No newline at end of file
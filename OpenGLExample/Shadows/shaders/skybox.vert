@@ -4,12 +4,13 @@ layout (location = 0) in vec3 aPos; //Position
 
 out vec3 TexCoords;
 
-uniform mat4 u_projection;
-uniform mat4 u_view;
+#include "common/frameData.glsl"
 
 void main()
 {
     TexCoords = aPos;
-    vec4 pos = u_projection * u_view * vec4(aPos, 1.0);
+    //Remove translation so the skybox stays centered on the camera
+    mat4 view = mat4(mat3(u_view));
+    vec4 pos = u_projection * view * vec4(aPos, 1.0);
     gl_Position = pos.xyww;
 }
\ No newline at end of file
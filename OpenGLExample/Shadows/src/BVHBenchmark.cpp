@@ -0,0 +1,136 @@
+#include "BVHBenchmark.h"
+#include "DynamicBVH.h"
+#include "FrustumCuller.h"
+#include "Timer.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+const int NUM_QUERIES = 1000;
+
+void printRow(const char* name, float ms, size_t results)
+{
+    std::cout << "  " << name << ": " << ms << " ms";
+    if (results > 0)
+        std::cout << " (" << results << " results)";
+    std::cout << std::endl;
+}
+
+void runWithCount(size_t count)
+{
+    //Keep density constant so query results scale with the object count
+    float worldSize = 10.0f * std::cbrt((float)count);
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+    std::uniform_real_distribution<float> size(0.25f, 1.0f);
+    std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+
+    std::vector<AABB> boxes(count);
+    for (AABB& box : boxes) {
+        glm::vec3 center(position(rng), position(rng), position(rng));
+        glm::vec3 extents(size(rng), size(rng), size(rng));
+        box = { center - extents, center + extents };
+    }
+
+    std::cout << count << " objects" << std::endl;
+    DynamicBVH bvh = DynamicBVH(0.1f);
+    std::vector<int> proxies(count);
+    {
+        Timer timer;
+        for (size_t i = 0; i < count; i++)
+            proxies[i] = bvh.Insert(boxes[i], (uint32_t)i);
+        printRow("insert", timer.ElapsedMs(), 0);
+    }
+    std::cout << "  height " << bvh.GetHeight() << ", area ratio " << bvh.GetAreaRatio() << std::endl;
+
+    //Small moves mostly stay inside the fattened boxes
+    {
+        size_t reinserted = 0;
+        Timer timer;
+        for (size_t i = 0; i < count; i++) {
+            glm::vec3 offset(jitter(rng), jitter(rng), jitter(rng));
+            boxes[i].min += offset;
+            boxes[i].max += offset;
+            reinserted += bvh.Move(proxies[i], boxes[i]) ? 1 : 0;
+        }
+        printRow("move all", timer.ElapsedMs(), reinserted);
+    }
+    {
+        Timer timer;
+        for (size_t i = 0; i < count; i++)
+            bvh.SetBounds(proxies[i], boxes[i]);
+        bvh.Refit();
+        printRow("set bounds + refit", timer.ElapsedMs(), 0);
+    }
+
+    //Camera in the middle of the world looking down +Z
+    glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, worldSize * 0.5f)
+        * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum(viewProjection);
+    {
+        size_t results = 0;
+        Timer timer;
+        bvh.QueryFrustum(frustum, [&results](uint32_t) { results++; });
+        printRow("frustum query", timer.ElapsedMs(), results);
+    }
+    {
+        FrustumCuller culler;
+        for (const AABB& box : boxes)
+            culler.Add(box);
+        std::vector<uint8_t> visible;
+        Timer timer;
+        size_t results = culler.Cull(frustum, visible);
+        printRow("frustum brute force SIMD", timer.ElapsedMs(), results);
+    }
+
+    std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+    {
+        size_t results = 0;
+        Timer timer;
+        for (int i = 0; i < NUM_QUERIES; i++) {
+            glm::vec3 origin(position(rng), position(rng), position(rng));
+            glm::vec3 dir(direction(rng), direction(rng), direction(rng));
+            bvh.QueryRay(origin, dir, 50.0f, [&results](uint32_t, float) { results++; });
+        }
+        printRow("1000 ray queries", timer.ElapsedMs(), results);
+    }
+    {
+        size_t results = 0;
+        Timer timer;
+        for (int i = 0; i < NUM_QUERIES; i++) {
+            BoundingSphere sphere = { glm::vec3(position(rng), position(rng), position(rng)), 5.0f };
+            bvh.QuerySphere(sphere, [&results](uint32_t) { results++; });
+        }
+        printRow("1000 sphere queries", timer.ElapsedMs(), results);
+    }
+    {
+        size_t results = 0;
+        Timer timer;
+        for (int i = 0; i < NUM_QUERIES; i++) {
+            glm::vec3 center(position(rng), position(rng), position(rng));
+            bvh.QueryBox({ center - glm::vec3(5.0f), center + glm::vec3(5.0f) }, [&results](uint32_t) { results++; });
+        }
+        printRow("1000 box queries", timer.ElapsedMs(), results);
+    }
+    {
+        Timer timer;
+        for (size_t i = 0; i < count; i += 2)
+            bvh.Remove(proxies[i]);
+        printRow("remove half", timer.ElapsedMs(), 0);
+    }
+}
+
+}
+
+void RunBVHBenchmark()
+{
+    const size_t COUNTS[] = { 10000, 100000, 1000000 };
+    for (size_t count : COUNTS)
+        runWithCount(count);
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+/// <summary>
+/// Times DynamicBVH building, updating and querying with 10K, 100K and 1M random boxes,
+/// and compares frustum queries with brute force SIMD culling. CPU only, needs no GL context.
+/// Run with the --benchmark-bvh command line argument.
+/// </summary>
+void RunBVHBenchmark();
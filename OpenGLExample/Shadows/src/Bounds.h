@@ -0,0 +1,47 @@
+#pragma once
+#include <cmath>
+#include <glm/glm.hpp>
+
+/// <summary>
+/// Axis aligned bounding box
+/// </summary>
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    inline glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+    inline glm::vec3 GetExtents() const { return (max - min) * 0.5f; }
+
+    /// <summary>
+    /// Smallest box containing this box after transforming it by matrix
+    /// </summary>
+    AABB Transform(const glm::mat4& matrix) const
+    {
+        glm::vec3 center = glm::vec3(matrix * glm::vec4(GetCenter(), 1.0f));
+        glm::vec3 extents = GetExtents();
+        //Each new extent is the extents projected onto that world axis
+        glm::vec3 worldExtents;
+        for (int i = 0; i < 3; i++)
+            worldExtents[i] = std::abs(matrix[0][i]) * extents.x + std::abs(matrix[1][i]) * extents.y + std::abs(matrix[2][i]) * extents.z;
+        return { center - worldExtents, center + worldExtents };
+    }
+};
+
+/// <summary>
+/// Sphere enclosing a mesh. Cheaper to test than an AABB, but usually looser
+/// </summary>
+struct BoundingSphere {
+    glm::vec3 center;
+    float radius;
+
+    /// <summary>
+    /// Sphere containing this sphere after transforming it by matrix. Non-uniform scale uses the largest axis
+    /// </summary>
+    BoundingSphere Transform(const glm::mat4& matrix) const
+    {
+        glm::vec3 worldCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+        float scale = std::sqrt(glm::max(glm::max(glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+            glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]))), glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2]))));
+        return { worldCenter, radius * scale };
+    }
+};
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class Shader;
+class Primitive;
+class Material;
+
+/// <summary>
+/// One recorded draw. Holds no GL state, only what to draw with and where its per-object data lives
+/// </summary>
+struct DrawPacket {
+    Shader* shader;
+    Primitive* primitive;
+    //Null for passes that don't shade
+    Material* material;
+    //Entry in the per-object uniform buffer
+    uint32_t objectIndex;
+    //Distance from the pass's viewpoint, for sorting
+    float depth;
+    uint8_t pass;
+    bool transparent;
+};
+
+/// <summary>
+/// Draw packets recorded by one thread. Recording makes no GL calls, so worker threads can each fill their own list
+/// while the GL thread later merges them into a RenderQueue (see RenderQueue::Submit) and replays them.
+/// A list must only be written by one thread at a time.
+/// </summary>
+class CommandList {
+public:
+    //Keeps the allocation for the next frame
+    inline void Clear() { m_packets.clear(); }
+    inline void Draw(unsigned int pass, Shader* shader, Primitive* primitive, Material* material, size_t objectIndex, float depth, bool transparent = false) {
+        m_packets.push_back({ shader, primitive, material, (uint32_t)objectIndex, depth, (uint8_t)pass, transparent });
+    }
+    inline const std::vector<DrawPacket>& GetPackets() const { return m_packets; }
+    inline size_t GetCount() const { return m_packets.size(); }
+private:
+    std::vector<DrawPacket> m_packets;
+};
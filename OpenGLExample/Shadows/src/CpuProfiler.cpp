@@ -0,0 +1,235 @@
+#include "CpuProfiler.h"
+
+#if CPU_PROFILER_ENABLED
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum EventType : uint8_t {
+    EVENT_ZONE,
+    EVENT_COUNTER,
+    EVENT_FRAME
+};
+
+struct Event {
+    const char* name;
+    uint64_t time;
+    //Duration of zones, value of counters, number of frames
+    int64_t value;
+    EventType type;
+};
+
+const size_t CHUNK_SIZE = 4096;
+const size_t MAX_CHUNKS = CpuProfiler::MAX_EVENTS_PER_THREAD / CHUNK_SIZE;
+
+//Written only by its thread. Chunks are allocated on first use and kept for later captures
+struct ThreadBuffer {
+    std::string name;
+    unsigned int id;
+    std::atomic<Event*> chunks[MAX_CHUNKS];
+    //Published with release after the event is written, so a reader never sees a partial event
+    std::atomic<size_t> count;
+    //Capture the events belong to. Events of older captures are overwritten
+    std::atomic<unsigned int> capture;
+    std::atomic<size_t> dropped;
+
+    ThreadBuffer() : id(0), count(0), capture(0), dropped(0) {
+        for (auto& chunk : chunks)
+            chunk = nullptr;
+    }
+    ~ThreadBuffer() {
+        for (auto& chunk : chunks)
+            delete[] chunk.load();
+    }
+};
+
+const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+//Buffers are only added under the mutex, never removed
+std::mutex s_threadsMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> s_threads;
+std::atomic<unsigned int> s_capture(0);
+std::atomic<int64_t> s_frame(0);
+
+thread_local ThreadBuffer* t_buffer = nullptr;
+
+ThreadBuffer* getThreadBuffer()
+{
+    if (t_buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(s_threadsMutex);
+        s_threads.emplace_back(new ThreadBuffer());
+        t_buffer = s_threads.back().get();
+        t_buffer->id = (unsigned int)s_threads.size() - 1;
+        t_buffer->name = "Thread " + std::to_string(t_buffer->id);
+    }
+    return t_buffer;
+}
+
+void record(const Event& event)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+    unsigned int capture = s_capture.load(std::memory_order_acquire);
+    if (buffer->capture.load(std::memory_order_relaxed) != capture) {
+        buffer->count.store(0, std::memory_order_relaxed);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+        buffer->capture.store(capture, std::memory_order_release);
+    }
+
+    size_t index = buffer->count.load(std::memory_order_relaxed);
+    size_t chunkIndex = index / CHUNK_SIZE;
+    if (chunkIndex >= MAX_CHUNKS) {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Event* chunk = buffer->chunks[chunkIndex].load(std::memory_order_relaxed);
+    if (chunk == nullptr) {
+        chunk = new Event[CHUNK_SIZE];
+        buffer->chunks[chunkIndex].store(chunk, std::memory_order_release);
+    }
+    chunk[index % CHUNK_SIZE] = event;
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+//Names are literals, but may still hold characters JSON needs escaped
+void writeString(std::ofstream& file, const char* text)
+{
+    file << '"';
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            file << '\\';
+        file << *c;
+    }
+    file << '"';
+}
+
+}
+
+std::atomic<bool> CpuProfiler::s_capturing(false);
+
+void CpuProfiler::Start()
+{
+    s_capture.fetch_add(1, std::memory_order_release);
+    s_frame = 0;
+    s_capturing.store(true, std::memory_order_relaxed);
+}
+
+void CpuProfiler::Stop()
+{
+    s_capturing.store(false, std::memory_order_relaxed);
+}
+
+bool CpuProfiler::WriteChromeTrace(const char* path)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+        return false;
+
+    unsigned int capture = s_capture.load(std::memory_order_acquire);
+    std::lock_guard<std::mutex> lock(s_threadsMutex);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separate = [&file, &first]() {
+        if (!first)
+            file << ",\n";
+        first = false;
+    };
+    file.precision(3);
+    file << std::fixed;
+    for (const auto& thread : s_threads)
+    {
+        if (thread->capture.load(std::memory_order_acquire) != capture)
+            continue;
+        separate();
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id << ",\"args\":{\"name\":";
+        writeString(file, thread->name.c_str());
+        file << "}}";
+
+        size_t count = thread->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; i++)
+        {
+            const Event& event = thread->chunks[i / CHUNK_SIZE].load(std::memory_order_acquire)[i % CHUNK_SIZE];
+            //Trace times are in microseconds
+            separate();
+            file << "{\"name\":";
+            writeString(file, event.name);
+            file << ",\"pid\":1,\"tid\":" << thread->id << ",\"ts\":" << event.time / 1000.0;
+            switch (event.type) {
+            case EVENT_ZONE:
+                file << ",\"ph\":\"X\",\"dur\":" << event.value / 1000.0 << "}";
+                break;
+            case EVENT_COUNTER:
+                file << ",\"ph\":\"C\",\"args\":{\"value\":" << event.value << "}}";
+                break;
+            case EVENT_FRAME:
+                file << ",\"ph\":\"i\",\"s\":\"g\",\"args\":{\"frame\":" << event.value << "}}";
+                break;
+            }
+        }
+    }
+    file << "\n]}\n";
+    return file.good();
+}
+
+void CpuProfiler::SetThreadName(const char* name)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+    //WriteChromeTrace reads names under the same lock
+    std::lock_guard<std::mutex> lock(s_threadsMutex);
+    buffer->name = name;
+}
+
+void CpuProfiler::Counter(const char* name, int64_t value)
+{
+    if (IsCapturing())
+        record({ name, Now(), value, EVENT_COUNTER });
+}
+
+void CpuProfiler::Frame()
+{
+    if (IsCapturing())
+        record({ "Frame", Now(), s_frame++, EVENT_FRAME });
+}
+
+uint64_t CpuProfiler::Now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_epoch).count();
+}
+
+size_t CpuProfiler::GetEventCount()
+{
+    unsigned int capture = s_capture.load(std::memory_order_acquire);
+    std::lock_guard<std::mutex> lock(s_threadsMutex);
+    size_t count = 0;
+    for (const auto& thread : s_threads)
+    {
+        if (thread->capture.load(std::memory_order_acquire) == capture)
+            count += thread->count.load(std::memory_order_acquire);
+    }
+    return count;
+}
+
+size_t CpuProfiler::GetDroppedCount()
+{
+    unsigned int capture = s_capture.load(std::memory_order_acquire);
+    std::lock_guard<std::mutex> lock(s_threadsMutex);
+    size_t dropped = 0;
+    for (const auto& thread : s_threads)
+    {
+        if (thread->capture.load(std::memory_order_acquire) == capture)
+            dropped += thread->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+void CpuProfiler::recordZone(const char* name, uint64_t start, uint64_t end)
+{
+    record({ name, start, (int64_t)(end - start), EVENT_ZONE });
+}
+
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+//Set to 0, e.g. with /DCPU_PROFILER_ENABLED=0, to compile every CPU_PROFILE_ macro to nothing
+#ifndef CPU_PROFILER_ENABLED
+#define CPU_PROFILER_ENABLED 1
+#endif
+
+#if CPU_PROFILER_ENABLED
+
+#include <atomic>
+
+/// <summary>
+/// Records scoped zones, counters and frame markers while a capture runs, and writes them as Chrome Trace Event
+/// JSON for chrome://tracing or Perfetto. Use it through the CPU_PROFILE_ macros below.
+/// Every thread appends to its own buffer without locking; the buffer is only read back after Stop().
+/// Names must be string literals or otherwise outlive the capture.
+/// Outside a capture a zone costs one relaxed atomic load.
+/// </summary>
+class CpuProfiler {
+public:
+    //Events kept per thread and capture. Later ones are dropped
+    static const size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+    //Times the enclosing scope
+    class Zone {
+    public:
+        explicit Zone(const char* name) : m_name(name), m_active(IsCapturing()) {
+            if (m_active)
+                m_start = Now();
+        }
+        ~Zone() {
+            if (m_active)
+                recordZone(m_name, m_start, Now());
+        }
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+    private:
+        const char* m_name;
+        bool m_active;
+        uint64_t m_start = 0;
+    };
+
+    //Discards the last capture and starts recording on all threads
+    static void Start();
+    static void Stop();
+    inline static bool IsCapturing() { return s_capturing.load(std::memory_order_relaxed); }
+    //Writes the last capture. Call after Stop(). Returns false if the file can't be written
+    static bool WriteChromeTrace(const char* path);
+
+    //Name shown for the calling thread's track. Call once when the thread starts
+    static void SetThreadName(const char* name);
+    static void Counter(const char* name, int64_t value);
+    //Marks the start of a frame
+    static void Frame();
+
+    //Nanoseconds since the profiler was loaded
+    static uint64_t Now();
+    //Events recorded and dropped by the last capture, over all threads
+    static size_t GetEventCount();
+    static size_t GetDroppedCount();
+private:
+    static std::atomic<bool> s_capturing;
+
+    static void recordZone(const char* name, uint64_t start, uint64_t end);
+};
+
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_INNER(a, b)
+#define CPU_PROFILE_ZONE(name) CpuProfiler::Zone CPU_PROFILE_CONCAT(cpuProfileZone, __LINE__)(name)
+#define CPU_PROFILE_COUNTER(name, value) do { if (CpuProfiler::IsCapturing()) CpuProfiler::Counter(name, (int64_t)(value)); } while (0)
+#define CPU_PROFILE_FRAME() CpuProfiler::Frame()
+#define CPU_PROFILE_THREAD(name) CpuProfiler::SetThreadName(name)
+
+#else
+
+//Compiled out. Control calls remain so callers don't need their own #if
+class CpuProfiler {
+public:
+    inline static void Start() {}
+    inline static void Stop() {}
+    inline static bool IsCapturing() { return false; }
+    inline static bool WriteChromeTrace(const char*) { return false; }
+    inline static size_t GetEventCount() { return 0; }
+    inline static size_t GetDroppedCount() { return 0; }
+};
+
+#define CPU_PROFILE_ZONE(name) do {} while (0)
+#define CPU_PROFILE_COUNTER(name, value) do {} while (0)
+#define CPU_PROFILE_FRAME() do {} while (0)
+#define CPU_PROFILE_THREAD(name) do {} while (0)
+
+#endif
@@ -0,0 +1,284 @@
+#include "DynamicBVH.h"
+
+#include <algorithm>
+
+DynamicBVH::DynamicBVH(float margin) : m_margin(margin)
+{
+}
+
+int DynamicBVH::Insert(const AABB& box, uint32_t userId)
+{
+    int proxy = allocateNode();
+    Node& node = m_nodes[proxy];
+    node.box = { box.min - glm::vec3(m_margin), box.max + glm::vec3(m_margin) };
+    node.userId = userId;
+    node.height = 0;
+    insertLeaf(proxy);
+    m_leafCount++;
+    return proxy;
+}
+
+void DynamicBVH::Remove(int proxy)
+{
+    removeLeaf(proxy);
+    freeNode(proxy);
+    m_leafCount--;
+}
+
+bool DynamicBVH::Move(int proxy, const AABB& box)
+{
+    if (contains(m_nodes[proxy].box, box))
+        return false;
+
+    removeLeaf(proxy);
+    m_nodes[proxy].box = { box.min - glm::vec3(m_margin), box.max + glm::vec3(m_margin) };
+    insertLeaf(proxy);
+    return true;
+}
+
+void DynamicBVH::SetBounds(int proxy, const AABB& box)
+{
+    m_nodes[proxy].box = box;
+}
+
+void DynamicBVH::Refit()
+{
+    if (m_root != NULL_NODE)
+        refitNode(m_root);
+}
+
+void DynamicBVH::Clear()
+{
+    m_nodes.clear();
+    m_root = NULL_NODE;
+    m_freeList = NULL_NODE;
+    m_leafCount = 0;
+}
+
+float DynamicBVH::GetAreaRatio() const
+{
+    if (m_root == NULL_NODE)
+        return 0.0f;
+    float rootArea = surfaceArea(m_nodes[m_root].box);
+    float totalArea = 0.0f;
+    for (const Node& node : m_nodes)
+    {
+        if (node.height > 0)
+            totalArea += surfaceArea(node.box);
+    }
+    return rootArea > 0.0f ? totalArea / rootArea : 0.0f;
+}
+
+int DynamicBVH::allocateNode()
+{
+    if (m_freeList == NULL_NODE) {
+        m_nodes.push_back(Node());
+        m_freeList = (int)m_nodes.size() - 1;
+        m_nodes.back().parent = NULL_NODE;
+    }
+    int index = m_freeList;
+    Node& node = m_nodes[index];
+    m_freeList = node.parent;
+    node.parent = NULL_NODE;
+    node.child1 = NULL_NODE;
+    node.child2 = NULL_NODE;
+    node.height = 0;
+    node.userId = 0;
+    return index;
+}
+
+void DynamicBVH::freeNode(int node)
+{
+    m_nodes[node].parent = m_freeList;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+void DynamicBVH::insertLeaf(int leaf)
+{
+    if (m_root == NULL_NODE) {
+        m_root = leaf;
+        m_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    //Walk down towards the sibling that makes the tree's surface area grow the least
+    AABB leafBox = m_nodes[leaf].box;
+    int index = m_root;
+    while (!m_nodes[index].IsLeaf())
+    {
+        const Node& node = m_nodes[index];
+        float area = surfaceArea(node.box);
+        float combinedArea = surfaceArea(merge(node.box, leafBox));
+        //Cost of pairing the leaf with this whole subtree
+        float cost = 2.0f * combinedArea;
+        //Every ancestor below here grows by at least this much
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        float childCosts[2];
+        int children[2] = { node.child1, node.child2 };
+        for (int i = 0; i < 2; i++)
+        {
+            const Node& child = m_nodes[children[i]];
+            float mergedArea = surfaceArea(merge(leafBox, child.box));
+            childCosts[i] = (child.IsLeaf() ? mergedArea : mergedArea - surfaceArea(child.box)) + inheritanceCost;
+        }
+
+        if (cost < childCosts[0] && cost < childCosts[1])
+            break;
+        index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+    }
+    int sibling = index;
+
+    //New parent replaces the sibling
+    int oldParent = m_nodes[sibling].parent;
+    int newParent = allocateNode();
+    Node& parentNode = m_nodes[newParent];
+    parentNode.parent = oldParent;
+    parentNode.box = merge(leafBox, m_nodes[sibling].box);
+    parentNode.height = m_nodes[sibling].height + 1;
+    parentNode.child1 = sibling;
+    parentNode.child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent == NULL_NODE) {
+        m_root = newParent;
+    }
+    else if (m_nodes[oldParent].child1 == sibling) {
+        m_nodes[oldParent].child1 = newParent;
+    }
+    else {
+        m_nodes[oldParent].child2 = newParent;
+    }
+
+    fixUpwards(m_nodes[leaf].parent);
+}
+
+void DynamicBVH::removeLeaf(int leaf)
+{
+    if (leaf == m_root) {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    int parent = m_nodes[leaf].parent;
+    int grandParent = m_nodes[parent].parent;
+    int sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    //The sibling takes the parent's place
+    if (grandParent == NULL_NODE) {
+        m_root = sibling;
+        m_nodes[sibling].parent = NULL_NODE;
+        freeNode(parent);
+        return;
+    }
+    if (m_nodes[grandParent].child1 == parent)
+        m_nodes[grandParent].child1 = sibling;
+    else
+        m_nodes[grandParent].child2 = sibling;
+    m_nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    fixUpwards(grandParent);
+}
+
+void DynamicBVH::fixUpwards(int node)
+{
+    int index = node;
+    while (index != NULL_NODE)
+    {
+        index = balance(index);
+        Node& current = m_nodes[index];
+        const Node& child1 = m_nodes[current.child1];
+        const Node& child2 = m_nodes[current.child2];
+        current.height = 1 + std::max(child1.height, child2.height);
+        current.box = merge(child1.box, child2.box);
+        index = current.parent;
+    }
+}
+
+int DynamicBVH::balance(int a)
+{
+    //Node names follow the diagram: A is the subtree root, B and C its children
+    Node& nodeA = m_nodes[a];
+    if (nodeA.IsLeaf() || nodeA.height < 2)
+        return a;
+
+    int b = nodeA.child1;
+    int c = nodeA.child2;
+    int heightDifference = m_nodes[c].height - m_nodes[b].height;
+
+    //Rotates child "up" into A's place. A keeps "other" and the shorter of up's children
+    auto rotateUp = [this](int root, int up, int other) {
+        Node& rootNode = m_nodes[root];
+        Node& upNode = m_nodes[up];
+        int f = upNode.child1;
+        int g = upNode.child2;
+
+        upNode.child1 = root;
+        upNode.parent = rootNode.parent;
+        rootNode.parent = up;
+
+        if (upNode.parent == NULL_NODE)
+            m_root = up;
+        else if (m_nodes[upNode.parent].child1 == root)
+            m_nodes[upNode.parent].child1 = up;
+        else
+            m_nodes[upNode.parent].child2 = up;
+
+        int keep = f, give = g;
+        if (m_nodes[f].height < m_nodes[g].height)
+            std::swap(keep, give);
+        upNode.child2 = keep;
+        if (rootNode.child1 == up)
+            rootNode.child1 = give;
+        else
+            rootNode.child2 = give;
+        m_nodes[give].parent = root;
+
+        rootNode.box = merge(m_nodes[other].box, m_nodes[give].box);
+        rootNode.height = 1 + std::max(m_nodes[other].height, m_nodes[give].height);
+        upNode.box = merge(rootNode.box, m_nodes[keep].box);
+        upNode.height = 1 + std::max(rootNode.height, m_nodes[keep].height);
+        return up;
+    };
+
+    if (heightDifference > 1)
+        return rotateUp(a, c, b);
+    if (heightDifference < -1)
+        return rotateUp(a, b, c);
+    return a;
+}
+
+AABB DynamicBVH::refitNode(int node)
+{
+    //Recursion depth is the tree height, which balancing keeps logarithmic
+    Node& current = m_nodes[node];
+    if (current.IsLeaf())
+        return current.box;
+    AABB box = merge(refitNode(current.child1), refitNode(current.child2));
+    m_nodes[node].box = box;
+    return box;
+}
+
+AABB DynamicBVH::merge(const AABB& a, const AABB& b)
+{
+    return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+}
+
+float DynamicBVH::surfaceArea(const AABB& box)
+{
+    glm::vec3 size = box.max - box.min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+bool DynamicBVH::contains(const AABB& outer, const AABB& inner)
+{
+    return glm::all(glm::lessThanEqual(outer.min, inner.min)) && glm::all(glm::greaterThanEqual(outer.max, inner.max));
+}
+
+bool DynamicBVH::overlaps(const AABB& a, const AABB& b)
+{
+    return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::greaterThanEqual(a.max, b.min));
+}
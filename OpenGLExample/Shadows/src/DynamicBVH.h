@@ -0,0 +1,248 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "Frustum.h"
+
+/// <summary>
+/// Bounding volume hierarchy over AABBs that supports adding, removing and moving objects without a rebuild.
+/// Leaves are inserted where they grow the tree's surface area the least and subtrees are rotated to stay balanced.
+/// Leaf boxes are fattened by a margin, so objects that move a little don't need to be reinserted.
+/// Objects are referred to by the proxy id returned from Insert. Queries report the userId passed to Insert.
+/// </summary>
+class DynamicBVH {
+public:
+    static const int NULL_NODE = -1;
+
+    /// <param name="margin">Distance leaf boxes are grown by on each side when inserted or moved</param>
+    explicit DynamicBVH(float margin = 0.1f);
+
+    //Adds an object and returns its proxy id
+    int Insert(const AABB& box, uint32_t userId);
+    void Remove(int proxy);
+    /// <summary>
+    /// Updates an object's box. The leaf is only reinserted if box left its fattened box.
+    /// Returns true if it was reinserted
+    /// </summary>
+    bool Move(int proxy, const AABB& box);
+    /// <summary>
+    /// Overwrites an object's box without changing the tree's shape. Call Refit() once all objects are updated.
+    /// Cheaper than Move when most objects change every frame, at the cost of a looser tree over time
+    /// </summary>
+    void SetBounds(int proxy, const AABB& box);
+    //Recomputes every internal box from its children, bottom up
+    void Refit();
+    void Clear();
+
+    inline uint32_t GetUserId(int proxy) const { return m_nodes[proxy].userId; }
+    inline const AABB& GetBounds(int proxy) const { return m_nodes[proxy].box; }
+    inline size_t GetLeafCount() const { return m_leafCount; }
+    inline int GetHeight() const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+    //Sum of the surface area of all internal nodes relative to the root. Lower means cheaper queries
+    float GetAreaRatio() const;
+
+    /// <summary>
+    /// Calls callback(userId) for every object whose box is at least partially inside frustum.
+    /// Subtrees completely inside are reported without testing their children
+    /// </summary>
+    template<typename Callback>
+    void QueryFrustum(const Frustum& frustum, Callback callback) const;
+    //Calls callback(userId) for every object whose box overlaps box
+    template<typename Callback>
+    void QueryBox(const AABB& box, Callback callback) const;
+    //Calls callback(userId) for every object whose box overlaps sphere
+    template<typename Callback>
+    void QuerySphere(const BoundingSphere& sphere, Callback callback) const;
+    /// <summary>
+    /// Calls callback(userId, distance) for every object whose box the ray enters before maxDistance.
+    /// direction doesn't need to be normalized; distances are in multiples of it. Objects are not reported in order
+    /// </summary>
+    template<typename Callback>
+    void QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback callback) const;
+private:
+    struct Node {
+        AABB box;
+        //Next free node while on the free list
+        int parent;
+        int child1;
+        int child2;
+        //Leaves are 0, free nodes -1
+        int height;
+        uint32_t userId;
+
+        inline bool IsLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    //Traversal stack that lives on the C++ stack unless the tree gets unusually deep
+    class NodeStack {
+    public:
+        inline void Push(int node) {
+            if (m_size < INLINE_SIZE)
+                m_inline[m_size] = node;
+            else
+                m_overflow.push_back(node);
+            m_size++;
+        }
+        inline int Pop() {
+            m_size--;
+            if (m_size < INLINE_SIZE)
+                return m_inline[m_size];
+            int node = m_overflow.back();
+            m_overflow.pop_back();
+            return node;
+        }
+        inline bool IsEmpty() const { return m_size == 0; }
+    private:
+        static const size_t INLINE_SIZE = 128;
+        int m_inline[INLINE_SIZE];
+        std::vector<int> m_overflow;
+        size_t m_size = 0;
+    };
+
+    std::vector<Node> m_nodes;
+    int m_root = NULL_NODE;
+    int m_freeList = NULL_NODE;
+    size_t m_leafCount = 0;
+    float m_margin;
+
+    int allocateNode();
+    void freeNode(int node);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    //Rotates the subtree at node if its children's heights differ by more than one. Returns the new subtree root
+    int balance(int node);
+    //Recomputes box and height of node and its ancestors, balancing on the way up
+    void fixUpwards(int node);
+    AABB refitNode(int node);
+    template<typename Callback>
+    void reportSubtree(int node, Callback& callback) const;
+
+    static AABB merge(const AABB& a, const AABB& b);
+    static float surfaceArea(const AABB& box);
+    static bool contains(const AABB& outer, const AABB& inner);
+    static bool overlaps(const AABB& a, const AABB& b);
+};
+
+template<typename Callback>
+void DynamicBVH::reportSubtree(int node, Callback& callback) const
+{
+    NodeStack stack;
+    stack.Push(node);
+    while (!stack.IsEmpty())
+    {
+        const Node& current = m_nodes[stack.Pop()];
+        if (current.IsLeaf()) {
+            callback(current.userId);
+        }
+        else {
+            stack.Push(current.child1);
+            stack.Push(current.child2);
+        }
+    }
+}
+
+template<typename Callback>
+void DynamicBVH::QueryFrustum(const Frustum& frustum, Callback callback) const
+{
+    if (m_root == NULL_NODE)
+        return;
+    NodeStack stack;
+    stack.Push(m_root);
+    while (!stack.IsEmpty())
+    {
+        int index = stack.Pop();
+        const Node& node = m_nodes[index];
+        Frustum::Containment containment = frustum.ClassifyAABB(node.box);
+        if (containment == Frustum::OUTSIDE)
+            continue;
+        if (node.IsLeaf()) {
+            callback(node.userId);
+        }
+        else if (containment == Frustum::INSIDE) {
+            reportSubtree(index, callback);
+        }
+        else {
+            stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+}
+
+template<typename Callback>
+void DynamicBVH::QueryBox(const AABB& box, Callback callback) const
+{
+    if (m_root == NULL_NODE)
+        return;
+    NodeStack stack;
+    stack.Push(m_root);
+    while (!stack.IsEmpty())
+    {
+        const Node& node = m_nodes[stack.Pop()];
+        if (!overlaps(node.box, box))
+            continue;
+        if (node.IsLeaf()) {
+            callback(node.userId);
+        }
+        else {
+            stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+}
+
+template<typename Callback>
+void DynamicBVH::QuerySphere(const BoundingSphere& sphere, Callback callback) const
+{
+    if (m_root == NULL_NODE)
+        return;
+    float radiusSquared = sphere.radius * sphere.radius;
+    NodeStack stack;
+    stack.Push(m_root);
+    while (!stack.IsEmpty())
+    {
+        const Node& node = m_nodes[stack.Pop()];
+        //Squared distance from the center to the closest point of the box
+        glm::vec3 offset = glm::max(node.box.min - sphere.center, glm::vec3(0.0f)) + glm::max(sphere.center - node.box.max, glm::vec3(0.0f));
+        if (glm::dot(offset, offset) > radiusSquared)
+            continue;
+        if (node.IsLeaf()) {
+            callback(node.userId);
+        }
+        else {
+            stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+}
+
+template<typename Callback>
+void DynamicBVH::QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback callback) const
+{
+    if (m_root == NULL_NODE)
+        return;
+    //Division by zero gives infinities, which the slab test handles
+    glm::vec3 inverseDirection = 1.0f / direction;
+    NodeStack stack;
+    stack.Push(m_root);
+    while (!stack.IsEmpty())
+    {
+        const Node& node = m_nodes[stack.Pop()];
+        glm::vec3 t0 = (node.box.min - origin) * inverseDirection;
+        glm::vec3 t1 = (node.box.max - origin) * inverseDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float enter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+        float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+        if (enter > exit)
+            continue;
+        if (node.IsLeaf()) {
+            callback(node.userId, enter);
+        }
+        else {
+            stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+}
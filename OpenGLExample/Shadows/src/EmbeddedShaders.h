@@ -0,0 +1,307 @@
+// Generated by tools/embed_shaders.py from shaders/. Do not edit.
+#pragma once
+
+struct EmbeddedShader {
+    const char* path;
+    const char* source;
+};
+
+static const EmbeddedShader EMBEDDED_SHADERS[] = {
+    { "shaders/debugDepth.frag",
+R"GLSL(#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D depthMap;
+uniform float near_plane;
+uniform float far_plane;
+
+// required when using a perspective projection matrix
+float LinearizeDepth(float depth)
+{
+    float z = depth * 2.0 - 1.0; // Back to NDC 
+    return (2.0 * near_plane * far_plane) / (far_plane + near_plane - z * (far_plane - near_plane));	
+}
+
+void main()
+{             
+    float depthValue = texture(depthMap, TexCoords).r;
+    
+     //FragColor = vec4(vec3(LinearizeDepth(depthValue) / far_plane), 1.0); // perspective
+    FragColor = vec4(vec3(depthValue), 1.0); // orthographic
+    //FragColor = vec4(TexCoords.x,TexCoords.y,0.0,1.0);
+})GLSL"
+    },
+    { "shaders/debugDepth.vert",
+R"GLSL(#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+uniform vec3 scale;
+uniform vec3 offset;
+void main()
+{
+    TexCoords = aTexCoords;
+    vec3 pos = aPos * scale + offset;
+    gl_Position = vec4(pos, 1.0);
+})GLSL"
+    },
+    { "shaders/defaultLit.frag",
+R"GLSL(#version 330 core
+//Feature switches (USE_SHADOWS, USE_PCF, USE_SKYBOX_REFLECTION, USE_TILING) are injected by ShaderVariants
+
+out vec4 FragColor;
+
+in vec3 Color;
+in vec2 TexCoords;
+in vec3 Normal;
+in vec3 WorldPosition;
+#ifdef USE_SHADOWS
+in vec4 LightSpacePosition;
+#endif
+
+uniform sampler2D u_texture;
+uniform samplerCube u_skyboxTexture;
+uniform sampler2D u_shadowMap;
+
+#include "common/frameData.glsl"
+
+#include "common/materialData.glsl"
+
+#include "common/shadows.glsl"
+
+void main()
+{
+#ifdef USE_TILING
+    vec3 textureColor = texture(u_texture,TexCoords * u_tile).rgb;
+#else
+    vec3 textureColor = texture(u_texture,TexCoords).rgb;
+#endif
+
+    vec3 lightDir = normalize(u_lightPos - WorldPosition);
+
+    //Ambient
+    vec3 ambient = u_lightColor * u_ambientK;
+
+    //Diffuse
+    vec3 worldNorm = normalize(Normal);
+    float diffuseFactor = max(dot(worldNorm,lightDir),0);
+    vec3 diffuse = u_lightColor * diffuseFactor * u_diffuseK;
+
+    //Specular
+    vec3 viewDir = normalize(u_cameraPos - WorldPosition);
+    vec3 reflectDir = reflect(-lightDir,worldNorm);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float specFactor = pow(max(dot(worldNorm,halfwayDir),0.0),u_shininess);
+    vec3 specular = u_lightColor * specFactor * u_specularK;
+
+#ifdef USE_SHADOWS
+    float shadow = calculateShadow(u_shadowMap, LightSpacePosition, worldNorm, lightDir);
+#else
+    float shadow = 0.0;
+#endif
+    
+    vec3 col = textureColor * (ambient + ((1.0-shadow) * (diffuse + specular)));
+
+#ifdef USE_SKYBOX_REFLECTION
+    vec3 toCamera = normalize(WorldPosition - u_cameraPos);
+    vec3 reflectionDir = reflect(toCamera,normalize(Normal));
+    vec3 skyboxColor = texture(u_skyboxTexture,reflectionDir).rgb;
+    col = mix(col, skyboxColor, u_reflectivity);
+#endif
+    FragColor = vec4(col,1.0f);
+})GLSL"
+    },
+    { "shaders/defaultLit.vert",
+R"GLSL(#version 330 core
+//The layout here must match the vertex attributes defined in main.cpp
+layout (location = 0) in vec3 aPos; //Position
+layout (location = 1) in vec3 aColor; //Position
+layout (location = 2) in vec3 aNormal; //Tex coords
+layout (location = 3) in vec2 aTexCoord; //Tex coords
+
+out vec3 Color;
+out vec3 Normal;
+out vec3 WorldPosition;
+out vec2 TexCoords;
+#ifdef USE_SHADOWS
+out vec4 LightSpacePosition;
+#endif
+
+#include "common/objectData.glsl"
+
+void main()
+{
+    Color = aColor;
+    WorldPosition = vec3(u_model * vec4(aPos,1.0));
+    Normal = mat3(u_normalMatrix) * aNormal;
+
+    TexCoords = aTexCoord;
+#ifdef USE_SHADOWS
+    LightSpacePosition = u_lightMvp * vec4(aPos,1.0);
+#endif
+    gl_Position = u_mvp * vec4(aPos, 1.0);
+})GLSL"
+    },
+    { "shaders/occlusionProxy.frag",
+R"GLSL(#version 330 core
+
+//Only the depth test matters, color writes are masked off
+void main()
+{
+}
+)GLSL"
+    },
+    { "shaders/occlusionProxy.vert",
+R"GLSL(#version 330 core
+layout (location = 0) in vec3 aPos;
+
+#include "common/frameData.glsl"
+
+//World space box the unit cube is stretched over
+uniform vec3 u_boxCenter;
+uniform vec3 u_boxSize;
+
+void main()
+{
+    gl_Position = u_projection * u_view * vec4(u_boxCenter + aPos * u_boxSize, 1.0);
+}
+)GLSL"
+    },
+    { "shaders/renderToDepth.frag",
+R"GLSL(#version 330 core
+
+void main()
+{             
+    // gl_FragDepth = gl_FragCoord.z;
+}  )GLSL"
+    },
+    { "shaders/renderToDepth.vert",
+R"GLSL(#version 330 core
+layout (location = 0) in vec3 aPos;
+
+#include "common/objectData.glsl"
+
+void main()
+{
+    gl_Position = u_lightMvp * vec4(aPos, 1.0);
+} )GLSL"
+    },
+    { "shaders/skybox.frag",
+R"GLSL(#version 330 core
+out vec4 FragColor;
+
+in vec3 TexCoords;
+
+uniform samplerCube u_texture;
+
+void main()
+{
+    FragColor = texture(u_texture,TexCoords);
+})GLSL"
+    },
+    { "shaders/skybox.vert",
+R"GLSL(#version 330 core
+
+layout (location = 0) in vec3 aPos; //Position
+
+out vec3 TexCoords;
+
+#include "common/frameData.glsl"
+
+void main()
+{
+    TexCoords = aPos;
+    //Remove translation so the skybox stays centered on the camera
+    mat4 view = mat4(mat3(u_view));
+    vec4 pos = u_projection * view * vec4(aPos, 1.0);
+    gl_Position = pos.xyww;
+})GLSL"
+    },
+    { "shaders/common/frameData.glsl",
+R"GLSL(//Per-frame constants. Layout must match FrameData in UniformBlocks.h
+layout (std140) uniform FrameData
+{
+    mat4 u_projection;
+    mat4 u_view;
+    mat4 u_lightSpaceMatrix;
+    vec3 u_cameraPos;
+    vec3 u_lightPos;
+    vec3 u_lightColor;
+};
+)GLSL"
+    },
+    { "shaders/common/materialData.glsl",
+R"GLSL(//Per-material constants. Layout must match MaterialData in UniformBlocks.h
+layout (std140) uniform MaterialData
+{
+    vec2 u_tile;
+    float u_shininess;
+    float u_reflectivity;
+    //Weights of the ambient, diffuse and specular lighting terms
+    float u_ambientK;
+    float u_diffuseK;
+    float u_specularK;
+};)GLSL"
+    },
+    { "shaders/common/objectData.glsl",
+R"GLSL(//Per-object constants. Layout must match ObjectData in UniformBlocks.h
+layout (std140) uniform ObjectData
+{
+    mat4 u_model;
+    mat4 u_normalMatrix;
+    mat4 u_mvp;
+    mat4 u_lightMvp;
+};
+)GLSL"
+    },
+    { "shaders/common/shadows.glsl",
+R"GLSL(//Shadow map lookup shared by lit shaders. Enabled with USE_SHADOWS, filtered with USE_PCF
+#ifndef PCF_RADIUS
+#define PCF_RADIUS 1
+#endif
+
+#ifdef USE_SHADOWS
+//Returns 1 if in shadow, 0 if out of shadow
+//normal and lightDir are normalized, in world space
+float calculateShadow(sampler2D shadowMap, vec4 lightSpacePos, vec3 normal, vec3 lightDir){
+    vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w;
+    projCoords = projCoords * 0.5 + 0.5;
+
+    //Depth of current fragment from light's perspective (0-1)
+    float currentDepth = projCoords.z;
+
+    float bias = max(0.01 * (1.0 - dot(normal,lightDir)),0.001);
+
+#ifdef USE_PCF
+    //PCF filtering
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
+    for(int x = -PCF_RADIUS; x <= PCF_RADIUS; ++x)
+    {
+        for(int y = -PCF_RADIUS; y <= PCF_RADIUS; ++y)
+        {
+            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r; 
+            shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;        
+        }    
+    }
+    shadow /= float((2 * PCF_RADIUS + 1) * (2 * PCF_RADIUS + 1));
+#else
+    //Closest depth value from light's perspective (0-1)
+    float closestDepth = texture(shadowMap,projCoords.xy).r;
+    float shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
+#endif
+    
+    // keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
+    if(projCoords.z > 1.0)
+        shadow = 0.0;
+    return shadow;
+}
+#endif
+)GLSL"
+    },
+};
+
+static const unsigned int NUM_EMBEDDED_SHADERS = sizeof(EMBEDDED_SHADERS) / sizeof(EMBEDDED_SHADERS[0]);
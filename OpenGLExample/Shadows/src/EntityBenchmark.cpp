@@ -0,0 +1,54 @@
+#include "EntityBenchmark.h"
+#include "EntityStore.h"
+#include "EntitySystems.h"
+#include "JobSystem.h"
+#include "Timer.h"
+
+#include <iostream>
+#include <random>
+
+namespace {
+
+const size_t NUM_ENTITIES = 100000;
+const int NUM_FRAMES = 100;
+
+}
+
+void RunEntityBenchmark()
+{
+    EntityStore store;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> speed(0.1f, 1.0f);
+    const AABB unitCube = { glm::vec3(-0.5f), glm::vec3(0.5f) };
+
+    Timer createTimer;
+    for (size_t i = 0; i < NUM_ENTITIES; i++)
+    {
+        Entity entity = store.Create();
+        store.transforms.Add(entity, glm::vec3(position(rng), position(rng), position(rng)), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.5f));
+        store.bounds.Add(entity, unitCube);
+        store.spins.Add(entity, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(direction(rng), direction(rng), 1.0f), speed(rng));
+    }
+    float createTime = createTimer.ElapsedMs();
+
+    float spinTime = 0.0f, transformTime = 0.0f, boundsTime = 0.0f;
+    for (int frame = 0; frame < NUM_FRAMES; frame++)
+    {
+        Timer timer;
+        EntitySystems::UpdateSpin(store, frame / 60.0f);
+        spinTime += timer.Restart();
+        EntitySystems::UpdateTransforms(store);
+        transformTime += timer.Restart();
+        EntitySystems::UpdateBounds(store);
+        boundsTime += timer.Restart();
+    }
+
+    std::cout << store.GetEntityCount() << " spinning entities, " << JobSystem::GetThreadCount() << " threads" << std::endl;
+    std::cout << "  create: " << createTime << " ms" << std::endl;
+    std::cout << "  spin: " << spinTime / NUM_FRAMES << " ms" << std::endl;
+    std::cout << "  transforms: " << transformTime / NUM_FRAMES << " ms" << std::endl;
+    std::cout << "  bounds: " << boundsTime / NUM_FRAMES << " ms" << std::endl;
+    std::cout << "  frame total: " << (spinTime + transformTime + boundsTime) / NUM_FRAMES << " ms" << std::endl;
+}
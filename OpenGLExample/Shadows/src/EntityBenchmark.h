@@ -0,0 +1,7 @@
+#pragma once
+
+/// <summary>
+/// Creates 100K spinning cubes in an EntityStore and times the spin, transform and bounds systems per frame.
+/// CPU only, needs no GL context. Run with the --benchmark-entities command line argument.
+/// </summary>
+void RunEntityBenchmark();
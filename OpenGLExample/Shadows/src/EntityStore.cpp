@@ -0,0 +1,213 @@
+#include "EntityStore.h"
+
+#include <iostream>
+
+const uint32_t ComponentPool::NOT_FOUND;
+const uint32_t EntityStore::MAX_ENTITIES;
+
+bool ComponentPool::Has(Entity entity) const
+{
+    return IndexOf(entity) != NOT_FOUND;
+}
+
+uint32_t ComponentPool::IndexOf(Entity entity) const
+{
+    uint32_t index = EntityStore::GetIndex(entity);
+    if (index >= m_sparse.size())
+        return NOT_FOUND;
+    uint32_t dense = m_sparse[index];
+    //Also rejects older generations of the same slot
+    if (dense == NOT_FOUND || m_entities[dense] != entity)
+        return NOT_FOUND;
+    return dense;
+}
+
+uint32_t ComponentPool::addEntity(Entity entity)
+{
+    uint32_t index = EntityStore::GetIndex(entity);
+    if (index >= m_sparse.size())
+        m_sparse.resize(index + 1, NOT_FOUND);
+    m_sparse[index] = (uint32_t)m_entities.size();
+    m_entities.push_back(entity);
+    return m_sparse[index];
+}
+
+uint32_t ComponentPool::removeEntity(Entity entity)
+{
+    uint32_t dense = IndexOf(entity);
+    if (dense == NOT_FOUND)
+        return NOT_FOUND;
+    Entity last = m_entities.back();
+    m_entities[dense] = last;
+    m_sparse[EntityStore::GetIndex(last)] = dense;
+    m_entities.pop_back();
+    m_sparse[EntityStore::GetIndex(entity)] = NOT_FOUND;
+    return dense;
+}
+
+void TransformPool::Add(Entity entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, Entity parent)
+{
+    if (Has(entity))
+        return;
+    //Children keep their parent handle when it is removed. Adding it again below one of them would close a loop
+    for (uint32_t index = IndexOf(parent); index != NOT_FOUND; index = ParentIndexOf(index))
+    {
+        if (parents[index] == entity) {
+            parent = NULL_ENTITY;
+            break;
+        }
+    }
+    if (!Has(parent))
+        parent = NULL_ENTITY;
+    addEntity(entity);
+    positions.push_back(position);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    parents.push_back(parent);
+    world.push_back(glm::mat4(1.0f));
+    dirty.push_back(1);
+    changed.push_back(0);
+}
+
+void TransformPool::Remove(Entity entity)
+{
+    uint32_t index = removeEntity(entity);
+    if (index == NOT_FOUND)
+        return;
+    swapRemove(positions, index);
+    swapRemove(rotations, index);
+    swapRemove(scales, index);
+    swapRemove(parents, index);
+    swapRemove(world, index);
+    swapRemove(dirty, index);
+    swapRemove(changed, index);
+}
+
+void TransformPool::SetPosition(Entity entity, const glm::vec3& position)
+{
+    uint32_t index = IndexOf(entity);
+    if (index == NOT_FOUND)
+        return;
+    positions[index] = position;
+    dirty[index] = 1;
+}
+
+void TransformPool::SetRotation(Entity entity, const glm::quat& rotation)
+{
+    uint32_t index = IndexOf(entity);
+    if (index == NOT_FOUND)
+        return;
+    rotations[index] = rotation;
+    dirty[index] = 1;
+}
+
+uint32_t TransformPool::ParentIndexOf(uint32_t index) const
+{
+    return parents[index] == NULL_ENTITY ? NOT_FOUND : IndexOf(parents[index]);
+}
+
+void RenderablePool::Add(Entity entity, Primitive* primitive, Material* material, unsigned int flags)
+{
+    if (Has(entity))
+        return;
+    addEntity(entity);
+    primitives.push_back(primitive);
+    materials.push_back(material);
+    this->flags.push_back(flags);
+}
+
+void RenderablePool::Remove(Entity entity)
+{
+    uint32_t index = removeEntity(entity);
+    if (index == NOT_FOUND)
+        return;
+    swapRemove(primitives, index);
+    swapRemove(materials, index);
+    swapRemove(flags, index);
+}
+
+void BoundsPool::Add(Entity entity, const AABB& localBounds)
+{
+    if (Has(entity))
+        return;
+    addEntity(entity);
+    local.push_back(localBounds);
+    world.push_back(localBounds);
+}
+
+void BoundsPool::Remove(Entity entity)
+{
+    uint32_t index = removeEntity(entity);
+    if (index == NOT_FOUND)
+        return;
+    swapRemove(local, index);
+    swapRemove(world, index);
+}
+
+void SpinPool::Add(Entity entity, const glm::quat& baseRotation, const glm::vec3& axis, float speed)
+{
+    if (Has(entity))
+        return;
+    addEntity(entity);
+    baseRotations.push_back(baseRotation);
+    axes.push_back(glm::normalize(axis));
+    speeds.push_back(speed);
+}
+
+void SpinPool::Remove(Entity entity)
+{
+    uint32_t index = removeEntity(entity);
+    if (index == NOT_FOUND)
+        return;
+    swapRemove(baseRotations, index);
+    swapRemove(axes, index);
+    swapRemove(speeds, index);
+}
+
+Entity EntityStore::Create()
+{
+    uint32_t index;
+    if (!m_freeIndices.empty()) {
+        index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    }
+    else {
+        if (m_generations.size() >= MAX_ENTITIES) {
+            std::cout << "ERROR::ENTITY_STORE::TOO_MANY_ENTITIES" << std::endl;
+            return NULL_ENTITY;
+        }
+        index = (uint32_t)m_generations.size();
+        m_generations.push_back(0);
+    }
+    return index | ((uint32_t)m_generations[index] << 24);
+}
+
+void EntityStore::Destroy(Entity entity)
+{
+    if (!IsAlive(entity))
+        return;
+    transforms.Remove(entity);
+    renderables.Remove(entity);
+    bounds.Remove(entity);
+    spins.Remove(entity);
+
+    uint32_t index = GetIndex(entity);
+    m_generations[index]++;
+    m_freeIndices.push_back(index);
+}
+
+bool EntityStore::IsAlive(Entity entity) const
+{
+    uint32_t index = GetIndex(entity);
+    return index < m_generations.size() && m_generations[index] == GetGeneration(entity);
+}
+
+void EntityStore::Clear()
+{
+    transforms = TransformPool();
+    renderables = RenderablePool();
+    bounds = BoundsPool();
+    spins = SpinPool();
+    m_generations.clear();
+    m_freeIndices.clear();
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "Bounds.h"
+
+class Primitive;
+class Material;
+
+//Index in the low 24 bits, generation in the high 8 so stale handles to reused slots are detected
+typedef uint32_t Entity;
+const Entity NULL_ENTITY = 0xFFFFFFFFu;
+
+/// <summary>
+/// Sparse set of the entities that have one kind of component. Derived pools keep each component field
+/// in its own array, in the same dense order, so systems stream through exactly the fields they use.
+/// Removing swaps the last entry into the hole, keeping the arrays packed.
+/// </summary>
+class ComponentPool {
+public:
+    static const uint32_t NOT_FOUND = 0xFFFFFFFFu;
+
+    inline size_t GetCount() const { return m_entities.size(); }
+    //Entity owning each dense entry
+    inline const std::vector<Entity>& GetEntities() const { return m_entities; }
+    bool Has(Entity entity) const;
+    //Dense index of entity's component, NOT_FOUND if it has none
+    uint32_t IndexOf(Entity entity) const;
+protected:
+    //Returns the dense index of the new entry. The derived pool appends its fields
+    uint32_t addEntity(Entity entity);
+    //Returns the dense index that was freed. The derived pool must move its last entry there and pop
+    uint32_t removeEntity(Entity entity);
+
+    template<typename T>
+    static void swapRemove(std::vector<T>& values, uint32_t index) {
+        values[index] = values.back();
+        values.pop_back();
+    }
+private:
+    //Dense index per entity index
+    std::vector<uint32_t> m_sparse;
+    std::vector<Entity> m_entities;
+};
+
+//Local transform relative to an optional parent, and the world matrix derived from it.
+//Code writing positions, rotations or scales directly must set dirty, so the world matrix is recomputed
+class TransformPool : public ComponentPool {
+public:
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    //NULL_ENTITY for roots. A child whose parent loses its transform is treated as a root
+    std::vector<Entity> parents;
+    std::vector<glm::mat4> world;
+    //Local transform changed since the last update
+    std::vector<uint8_t> dirty;
+    //True if the last update recomputed the world matrix, e.g. to refresh data derived from it
+    std::vector<uint8_t> changed;
+
+    //parent must already have a transform, otherwise the entity becomes a root
+    void Add(Entity entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, Entity parent = NULL_ENTITY);
+    void Remove(Entity entity);
+    //Set the local transform and mark it dirty. Ignored if the entity has no transform
+    void SetPosition(Entity entity, const glm::vec3& position);
+    void SetRotation(Entity entity, const glm::quat& rotation);
+    //Dense index of the entry's parent, NOT_FOUND for roots
+    uint32_t ParentIndexOf(uint32_t index) const;
+};
+
+//What to draw an entity with. flags are for the renderer to interpret
+class RenderablePool : public ComponentPool {
+public:
+    std::vector<Primitive*> primitives;
+    std::vector<Material*> materials;
+    std::vector<unsigned int> flags;
+
+    void Add(Entity entity, Primitive* primitive, Material* material, unsigned int flags = 0);
+    void Remove(Entity entity);
+};
+
+//Local space box and its world space version, follows the transform
+class BoundsPool : public ComponentPool {
+public:
+    std::vector<AABB> local;
+    std::vector<AABB> world;
+
+    void Add(Entity entity, const AABB& localBounds);
+    void Remove(Entity entity);
+};
+
+//Constant rotation around an axis, on top of the rotation the entity was created with
+class SpinPool : public ComponentPool {
+public:
+    std::vector<glm::quat> baseRotations;
+    std::vector<glm::vec3> axes;
+    //Radians per second
+    std::vector<float> speeds;
+
+    void Add(Entity entity, const glm::quat& baseRotation, const glm::vec3& axis, float speed);
+    void Remove(Entity entity);
+};
+
+/// <summary>
+/// Creates and destroys entities and owns one pool per component type.
+/// Entities are plain handles; everything about them lives in the pools.
+/// </summary>
+class EntityStore {
+public:
+    //Indices 0xFFFFFF and up don't fit the handle, and would collide with NULL_ENTITY
+    static const uint32_t MAX_ENTITIES = 0xFFFFFFu;
+
+    TransformPool transforms;
+    RenderablePool renderables;
+    BoundsPool bounds;
+    SpinPool spins;
+
+    //Returns NULL_ENTITY once MAX_ENTITIES are alive
+    Entity Create();
+    //Removes the entity's components and frees its slot for reuse
+    void Destroy(Entity entity);
+    bool IsAlive(Entity entity) const;
+    inline size_t GetEntityCount() const { return m_generations.size() - m_freeIndices.size(); }
+    //Removes all entities. Handles from before are invalid and may alias new ones
+    void Clear();
+
+    static inline uint32_t GetIndex(Entity entity) { return entity & 0xFFFFFFu; }
+    static inline uint32_t GetGeneration(Entity entity) { return entity >> 24; }
+private:
+    std::vector<uint8_t> m_generations;
+    std::vector<uint32_t> m_freeIndices;
+};
@@ -0,0 +1,77 @@
+#include "EntitySystems.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+
+//Entries per job. Large enough that waking workers pays off
+const size_t ENTITIES_PER_BATCH = 1024;
+
+//Translate * rotate * scale
+static glm::mat4 getLocalMatrix(const TransformPool& transforms, uint32_t index)
+{
+    glm::mat4 local = glm::mat4_cast(transforms.rotations[index]);
+    local[0] *= transforms.scales[index].x;
+    local[1] *= transforms.scales[index].y;
+    local[2] *= transforms.scales[index].z;
+    local[3] = glm::vec4(transforms.positions[index], 1.0f);
+    return local;
+}
+
+void EntitySystems::UpdateSpin(EntityStore& store, float time)
+{
+    SpinPool& spins = store.spins;
+    TransformPool& transforms = store.transforms;
+    JobSystem::ParallelFor(spins.GetCount(), ENTITIES_PER_BATCH, [&spins, &transforms, time](size_t begin, size_t end) {
+        const std::vector<Entity>& entities = spins.GetEntities();
+        for (size_t i = begin; i < end; i++)
+        {
+            uint32_t transform = transforms.IndexOf(entities[i]);
+            if (transform == ComponentPool::NOT_FOUND)
+                continue;
+            transforms.rotations[transform] = spins.baseRotations[i] * glm::angleAxis(time * spins.speeds[i], spins.axes[i]);
+            transforms.dirty[transform] = 1;
+        }
+    });
+}
+
+void EntitySystems::UpdateTransforms(EntityStore& store)
+{
+    TransformPool& transforms = store.transforms;
+    //Entries are in no particular order, so each walks its own chain of parents instead of reading their world matrix.
+    //Only the entry itself is written, and chains are short
+    JobSystem::ParallelFor(transforms.GetCount(), ENTITIES_PER_BATCH, [&transforms](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            bool update = transforms.dirty[i] != 0;
+            for (uint32_t parent = transforms.ParentIndexOf((uint32_t)i); parent != ComponentPool::NOT_FOUND && !update;
+                parent = transforms.ParentIndexOf(parent))
+                update = transforms.dirty[parent] != 0;
+            transforms.changed[i] = update ? 1 : 0;
+            if (!update)
+                continue;
+
+            glm::mat4 world = getLocalMatrix(transforms, (uint32_t)i);
+            for (uint32_t parent = transforms.ParentIndexOf((uint32_t)i); parent != ComponentPool::NOT_FOUND;
+                parent = transforms.ParentIndexOf(parent))
+                world = getLocalMatrix(transforms, parent) * world;
+            transforms.world[i] = world;
+        }
+    });
+    //Children read their parents' flags above, so clear them only once every entry is done
+    std::fill(transforms.dirty.begin(), transforms.dirty.end(), 0);
+}
+
+void EntitySystems::UpdateBounds(EntityStore& store)
+{
+    BoundsPool& bounds = store.bounds;
+    const TransformPool& transforms = store.transforms;
+    JobSystem::ParallelFor(bounds.GetCount(), ENTITIES_PER_BATCH, [&bounds, &transforms](size_t begin, size_t end) {
+        const std::vector<Entity>& entities = bounds.GetEntities();
+        for (size_t i = begin; i < end; i++)
+        {
+            uint32_t transform = transforms.IndexOf(entities[i]);
+            if (transform != ComponentPool::NOT_FOUND)
+                bounds.world[i] = bounds.local[i].Transform(transforms.world[transform]);
+        }
+    });
+}
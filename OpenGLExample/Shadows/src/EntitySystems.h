@@ -0,0 +1,16 @@
+#pragma once
+#include "EntityStore.h"
+
+/// <summary>
+/// Per-frame updates over the component pools of an EntityStore. Each one walks the dense arrays of
+/// its pool and is split across JobSystem threads. Run in order: spin, transforms, bounds.
+/// </summary>
+class EntitySystems {
+public:
+    //Sets the rotation of every spinning entity's transform for time in seconds
+    static void UpdateSpin(EntityStore& store, float time);
+    //Recomputes the world matrices of dirty transforms and their descendants, then clears dirty
+    static void UpdateTransforms(EntityStore& store);
+    //Transforms local boxes by their entity's world matrix
+    static void UpdateBounds(EntityStore& store);
+};
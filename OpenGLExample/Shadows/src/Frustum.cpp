@@ -0,0 +1,74 @@
+#include "Frustum.h"
+
+Frustum::Frustum()
+{
+    for (int i = 0; i < NUM_PLANES; i++)
+        m_planes[i] = glm::vec4(0.0f);
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+    //Gribb/Hartmann: each plane is the last row of the matrix plus or minus one of the others
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+    m_planes[PLANE_LEFT] = rows[3] + rows[0];
+    m_planes[PLANE_RIGHT] = rows[3] - rows[0];
+    m_planes[PLANE_BOTTOM] = rows[3] + rows[1];
+    m_planes[PLANE_TOP] = rows[3] - rows[1];
+    m_planes[PLANE_NEAR] = rows[3] + rows[2];
+    m_planes[PLANE_FAR] = rows[3] - rows[2];
+
+    for (int i = 0; i < NUM_PLANES; i++)
+        m_planes[i] /= glm::length(glm::vec3(m_planes[i]));
+}
+
+bool Frustum::TestSphere(const BoundingSphere& sphere) const
+{
+    for (int i = 0; i < NUM_PLANES; i++)
+    {
+        if (glm::dot(glm::vec3(m_planes[i]), sphere.center) + m_planes[i].w < -sphere.radius)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::TestAABB(const AABB& box) const
+{
+    glm::vec3 center = box.GetCenter();
+    glm::vec3 extents = box.GetExtents();
+    for (int i = 0; i < NUM_PLANES; i++)
+    {
+        glm::vec3 normal = glm::vec3(m_planes[i]);
+        //Distance from the center to the box corner furthest along the normal
+        float radius = glm::dot(extents, glm::abs(normal));
+        if (glm::dot(normal, center) + m_planes[i].w < -radius)
+            return false;
+    }
+    return true;
+}
+
+Frustum::Containment Frustum::ClassifyAABB(const AABB& box) const
+{
+    glm::vec3 center = box.GetCenter();
+    glm::vec3 extents = box.GetExtents();
+    Containment result = INSIDE;
+    for (int i = 0; i < NUM_PLANES; i++)
+    {
+        glm::vec3 normal = glm::vec3(m_planes[i]);
+        float radius = glm::dot(extents, glm::abs(normal));
+        float distance = glm::dot(normal, center) + m_planes[i].w;
+        if (distance < -radius)
+            return OUTSIDE;
+        if (distance < radius)
+            result = INTERSECTS;
+    }
+    return result;
+}
+
+void Frustum::RemovePlane(Plane plane)
+{
+    //Zero normal, positive distance: every point is on the inside
+    m_planes[plane] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "Bounds.h"
+
+/// <summary>
+/// Six planes of a view volume, extracted from a projection * view matrix.
+/// Plane normals point inwards and are normalized, so dot(plane.xyz, p) + plane.w is a signed distance.
+/// </summary>
+class Frustum {
+public:
+    enum Plane {
+        PLANE_LEFT,
+        PLANE_RIGHT,
+        PLANE_BOTTOM,
+        PLANE_TOP,
+        PLANE_NEAR,
+        PLANE_FAR,
+        NUM_PLANES
+    };
+
+    enum Containment {
+        OUTSIDE,
+        INTERSECTS,
+        INSIDE
+    };
+
+    Frustum();
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    inline const glm::vec4& GetPlane(int plane) const { return m_planes[plane]; }
+    //False if the sphere is completely outside
+    bool TestSphere(const BoundingSphere& sphere) const;
+    //False if the box is completely outside
+    bool TestAABB(const AABB& box) const;
+    //Like TestAABB, but also tells whether the box is completely inside, e.g. to accept a whole subtree
+    Containment ClassifyAABB(const AABB& box) const;
+    //Makes a plane accept everything, extending the volume to infinity on that side
+    void RemovePlane(Plane plane);
+private:
+    glm::vec4 m_planes[NUM_PLANES];
+};
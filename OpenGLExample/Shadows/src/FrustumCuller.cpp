@@ -0,0 +1,142 @@
+#include "FrustumCuller.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE2
+#endif
+
+void FrustumCuller::Clear()
+{
+    m_centerX.clear();
+    m_centerY.clear();
+    m_centerZ.clear();
+    m_extentX.clear();
+    m_extentY.clear();
+    m_extentZ.clear();
+}
+
+size_t FrustumCuller::Add(const AABB& worldBounds)
+{
+    glm::vec3 center = worldBounds.GetCenter();
+    glm::vec3 extents = worldBounds.GetExtents();
+    m_centerX.push_back(center.x);
+    m_centerY.push_back(center.y);
+    m_centerZ.push_back(center.z);
+    m_extentX.push_back(extents.x);
+    m_extentY.push_back(extents.y);
+    m_extentZ.push_back(extents.z);
+    return m_centerX.size() - 1;
+}
+
+int FrustumCuller::GetBatchWidth()
+{
+#if defined(FRUSTUM_CULLER_AVX)
+    return 8;
+#elif defined(FRUSTUM_CULLER_SSE2)
+    return 4;
+#else
+    return 1;
+#endif
+}
+
+size_t FrustumCuller::Cull(const Frustum& frustum, std::vector<uint8_t>& visible) const
+{
+    size_t count = GetCount();
+    visible.resize(count);
+    size_t numVisible = 0;
+    size_t i = 0;
+
+#if defined(FRUSTUM_CULLER_AVX)
+    __m256 planeX[Frustum::NUM_PLANES], planeY[Frustum::NUM_PLANES], planeZ[Frustum::NUM_PLANES], planeW[Frustum::NUM_PLANES];
+    __m256 absX[Frustum::NUM_PLANES], absY[Frustum::NUM_PLANES], absZ[Frustum::NUM_PLANES];
+    for (int p = 0; p < Frustum::NUM_PLANES; p++)
+    {
+        const glm::vec4& plane = frustum.GetPlane(p);
+        planeX[p] = _mm256_set1_ps(plane.x);
+        planeY[p] = _mm256_set1_ps(plane.y);
+        planeZ[p] = _mm256_set1_ps(plane.z);
+        planeW[p] = _mm256_set1_ps(plane.w);
+        absX[p] = _mm256_set1_ps(std::abs(plane.x));
+        absY[p] = _mm256_set1_ps(std::abs(plane.y));
+        absZ[p] = _mm256_set1_ps(std::abs(plane.z));
+    }
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(&m_centerX[i]), cy = _mm256_loadu_ps(&m_centerY[i]), cz = _mm256_loadu_ps(&m_centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&m_extentX[i]), ey = _mm256_loadu_ps(&m_extentY[i]), ez = _mm256_loadu_ps(&m_extentZ[i]);
+        __m256 outside = zero;
+        for (int p = 0; p < Frustum::NUM_PLANES; p++)
+        {
+            //Signed distance of the center plus the box's reach along the normal
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, planeX[p]), _mm256_mul_ps(cy, planeY[p])),
+                _mm256_add_ps(_mm256_mul_ps(cz, planeZ[p]), planeW[p]));
+            __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, absX[p]), _mm256_mul_ps(ey, absY[p])), _mm256_mul_ps(ez, absZ[p]));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+        }
+        int outsideMask = _mm256_movemask_ps(outside);
+        for (int lane = 0; lane < 8; lane++)
+        {
+            visible[i + lane] = (outsideMask >> lane) & 1 ? 0 : 1;
+            numVisible += visible[i + lane];
+        }
+    }
+#elif defined(FRUSTUM_CULLER_SSE2)
+    __m128 planeX[Frustum::NUM_PLANES], planeY[Frustum::NUM_PLANES], planeZ[Frustum::NUM_PLANES], planeW[Frustum::NUM_PLANES];
+    __m128 absX[Frustum::NUM_PLANES], absY[Frustum::NUM_PLANES], absZ[Frustum::NUM_PLANES];
+    for (int p = 0; p < Frustum::NUM_PLANES; p++)
+    {
+        const glm::vec4& plane = frustum.GetPlane(p);
+        planeX[p] = _mm_set1_ps(plane.x);
+        planeY[p] = _mm_set1_ps(plane.y);
+        planeZ[p] = _mm_set1_ps(plane.z);
+        planeW[p] = _mm_set1_ps(plane.w);
+        absX[p] = _mm_set1_ps(std::abs(plane.x));
+        absY[p] = _mm_set1_ps(std::abs(plane.y));
+        absZ[p] = _mm_set1_ps(std::abs(plane.z));
+    }
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&m_centerX[i]), cy = _mm_loadu_ps(&m_centerY[i]), cz = _mm_loadu_ps(&m_centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&m_extentX[i]), ey = _mm_loadu_ps(&m_extentY[i]), ez = _mm_loadu_ps(&m_extentZ[i]);
+        __m128 outside = zero;
+        for (int p = 0; p < Frustum::NUM_PLANES; p++)
+        {
+            //Signed distance of the center plus the box's reach along the normal
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, planeX[p]), _mm_mul_ps(cy, planeY[p])),
+                _mm_add_ps(_mm_mul_ps(cz, planeZ[p]), planeW[p]));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, absX[p]), _mm_mul_ps(ey, absY[p])), _mm_mul_ps(ez, absZ[p]));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+        }
+        int outsideMask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            visible[i + lane] = (outsideMask >> lane) & 1 ? 0 : 1;
+            numVisible += visible[i + lane];
+        }
+    }
+#endif
+
+    //Remainder that doesn't fill a register
+    for (; i < count; i++)
+    {
+        visible[i] = testBox(frustum, i) ? 1 : 0;
+        numVisible += visible[i];
+    }
+    return numVisible;
+}
+
+bool FrustumCuller::testBox(const Frustum& frustum, size_t index) const
+{
+    AABB box = {
+        glm::vec3(m_centerX[index] - m_extentX[index], m_centerY[index] - m_extentY[index], m_centerZ[index] - m_extentZ[index]),
+        glm::vec3(m_centerX[index] + m_extentX[index], m_centerY[index] + m_extentY[index], m_centerZ[index] + m_extentZ[index])
+    };
+    return frustum.TestAABB(box);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Bounds.h"
+#include "Frustum.h"
+
+/// <summary>
+/// Tests many world space boxes against a frustum at once.
+/// Boxes are stored as separate center and extent arrays per axis so one SIMD register holds the same
+/// component of 4 (SSE2) or 8 (AVX) boxes. Built without either, it falls back to one box at a time.
+/// </summary>
+class FrustumCuller {
+public:
+    //Removes all boxes
+    void Clear();
+    //Adds a box and returns its index
+    size_t Add(const AABB& worldBounds);
+    inline size_t GetCount() const { return m_centerX.size(); }
+    /// <summary>
+    /// Sets visible[i] to 1 for each box that is at least partially inside frustum, 0 otherwise.
+    /// Returns the number of visible boxes
+    /// </summary>
+    size_t Cull(const Frustum& frustum, std::vector<uint8_t>& visible) const;
+    //Boxes tested per SIMD instruction in this build
+    static int GetBatchWidth();
+private:
+    std::vector<float> m_centerX, m_centerY, m_centerZ;
+    std::vector<float> m_extentX, m_extentY, m_extentZ;
+
+    bool testBox(const Frustum& frustum, size_t index) const;
+};
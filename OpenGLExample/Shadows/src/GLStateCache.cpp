@@ -0,0 +1,156 @@
+#include "GLStateCache.h"
+
+//Start from the default state of a new context
+GLuint GLStateCache::s_program = 0;
+GLenum GLStateCache::s_activeUnit = GL_TEXTURE0;
+GLuint GLStateCache::s_texture2D[GLStateCache::MAX_TEXTURE_UNITS] = {};
+GLuint GLStateCache::s_textureCube[GLStateCache::MAX_TEXTURE_UNITS] = {};
+GLuint GLStateCache::s_vao = 0;
+GLenum GLStateCache::s_cullFace = GL_BACK;
+GLenum GLStateCache::s_depthFunc = GL_LESS;
+int GLStateCache::s_depthTest = 0;
+int GLStateCache::s_cullFaceEnabled = 0;
+
+unsigned int GLStateCache::s_issued = 0;
+unsigned int GLStateCache::s_skipped = 0;
+unsigned int GLStateCache::s_lastIssued = 0;
+unsigned int GLStateCache::s_lastSkipped = 0;
+
+void GLStateCache::UseProgram(GLuint program)
+{
+    if (update(s_program, program))
+        glUseProgram(program);
+}
+
+void GLStateCache::ActiveTexture(GLenum unit)
+{
+    if (update(s_activeUnit, unit))
+        glActiveTexture(unit);
+}
+
+void GLStateCache::BindTexture(GLenum target, GLuint texture)
+{
+    GLuint* slot = getTextureSlot(target);
+    if (slot == nullptr) {
+        //Untracked target or unit
+        s_issued++;
+        glBindTexture(target, texture);
+        return;
+    }
+    if (update(*slot, texture))
+        glBindTexture(target, texture);
+}
+
+void GLStateCache::BindVertexArray(GLuint vao)
+{
+    if (update(s_vao, vao))
+        glBindVertexArray(vao);
+}
+
+void GLStateCache::CullFace(GLenum mode)
+{
+    if (update(s_cullFace, mode))
+        glCullFace(mode);
+}
+
+void GLStateCache::DepthFunc(GLenum func)
+{
+    if (update(s_depthFunc, func))
+        glDepthFunc(func);
+}
+
+void GLStateCache::Enable(GLenum cap)
+{
+    int* state = getCapState(cap);
+    if (state == nullptr) {
+        s_issued++;
+        glEnable(cap);
+        return;
+    }
+    if (update(*state, 1))
+        glEnable(cap);
+}
+
+void GLStateCache::Disable(GLenum cap)
+{
+    int* state = getCapState(cap);
+    if (state == nullptr) {
+        s_issued++;
+        glDisable(cap);
+        return;
+    }
+    if (update(*state, 0))
+        glDisable(cap);
+}
+
+void GLStateCache::OnDeleteProgram(GLuint program)
+{
+    //Deleting the current program doesn't unbind it, but its name may be reused
+    if (s_program == program)
+        s_program = UNKNOWN;
+}
+
+void GLStateCache::OnDeleteTexture(GLuint texture)
+{
+    for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+    {
+        if (s_texture2D[i] == texture)
+            s_texture2D[i] = 0;
+        if (s_textureCube[i] == texture)
+            s_textureCube[i] = 0;
+    }
+}
+
+void GLStateCache::OnDeleteVertexArray(GLuint vao)
+{
+    if (s_vao == vao)
+        s_vao = 0;
+}
+
+void GLStateCache::Invalidate()
+{
+    s_program = UNKNOWN;
+    s_activeUnit = UNKNOWN;
+    for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+    {
+        s_texture2D[i] = UNKNOWN;
+        s_textureCube[i] = UNKNOWN;
+    }
+    s_vao = UNKNOWN;
+    s_cullFace = UNKNOWN;
+    s_depthFunc = UNKNOWN;
+    s_depthTest = -1;
+    s_cullFaceEnabled = -1;
+}
+
+void GLStateCache::BeginFrame()
+{
+    s_lastIssued = s_issued;
+    s_lastSkipped = s_skipped;
+    s_issued = 0;
+    s_skipped = 0;
+}
+
+GLuint* GLStateCache::getTextureSlot(GLenum target)
+{
+    //Unit isn't known until the first ActiveTexture call
+    if (s_activeUnit == UNKNOWN)
+        return nullptr;
+    unsigned int unit = s_activeUnit - GL_TEXTURE0;
+    if (unit >= MAX_TEXTURE_UNITS)
+        return nullptr;
+    if (target == GL_TEXTURE_2D)
+        return &s_texture2D[unit];
+    if (target == GL_TEXTURE_CUBE_MAP)
+        return &s_textureCube[unit];
+    return nullptr;
+}
+
+int* GLStateCache::getCapState(GLenum cap)
+{
+    if (cap == GL_DEPTH_TEST)
+        return &s_depthTest;
+    if (cap == GL_CULL_FACE)
+        return &s_cullFaceEnabled;
+    return nullptr;
+}
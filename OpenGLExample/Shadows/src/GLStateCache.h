@@ -0,0 +1,66 @@
+#pragma once
+#include <GL/glew.h>
+
+/// <summary>
+/// Shadows the currently bound GL state and drops calls that would not change it.
+/// All binds of programs, textures and vertex arrays must go through here, otherwise the shadow copy goes stale.
+/// Call Invalidate() after code that changes state behind its back.
+/// </summary>
+class GLStateCache {
+public:
+    static void UseProgram(GLuint program);
+    static void ActiveTexture(GLenum unit);
+    //Binds to the current active texture unit
+    static void BindTexture(GLenum target, GLuint texture);
+    static void BindVertexArray(GLuint vao);
+    static void CullFace(GLenum mode);
+    static void DepthFunc(GLenum func);
+    //Only GL_DEPTH_TEST and GL_CULL_FACE are tracked, others are passed through
+    static void Enable(GLenum cap);
+    static void Disable(GLenum cap);
+
+    //Must be called when deleting objects that may still be bound, since GL unbinds them
+    static void OnDeleteProgram(GLuint program);
+    static void OnDeleteTexture(GLuint texture);
+    static void OnDeleteVertexArray(GLuint vao);
+    //Forgets all shadowed state. The next call of each kind is always issued
+    static void Invalidate();
+
+    //Moves this frame's counters to the last frame values and resets them
+    static void BeginFrame();
+    inline static unsigned int GetIssuedCalls() { return s_lastIssued; }
+    inline static unsigned int GetSkippedCalls() { return s_lastSkipped; }
+private:
+    static const unsigned int MAX_TEXTURE_UNITS = 16;
+    static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+    static GLuint s_program;
+    static GLenum s_activeUnit;
+    static GLuint s_texture2D[MAX_TEXTURE_UNITS];
+    static GLuint s_textureCube[MAX_TEXTURE_UNITS];
+    static GLuint s_vao;
+    static GLenum s_cullFace;
+    static GLenum s_depthFunc;
+    //1 enabled, 0 disabled, -1 unknown
+    static int s_depthTest;
+    static int s_cullFaceEnabled;
+
+    static unsigned int s_issued;
+    static unsigned int s_skipped;
+    static unsigned int s_lastIssued;
+    static unsigned int s_lastSkipped;
+
+    //Returns true if the call must be issued, and updates the shadow value
+    template<typename T>
+    static bool update(T& current, T value) {
+        if (current == value) {
+            s_skipped++;
+            return false;
+        }
+        current = value;
+        s_issued++;
+        return true;
+    }
+    static GLuint* getTextureSlot(GLenum target);
+    static int* getCapState(GLenum cap);
+};
@@ -0,0 +1,261 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+
+const char* const GpuProfiler::FRAME_ZONE = "Frame";
+
+//Query targets in PipelineStatistic order
+static const GLenum STATISTIC_TARGETS[GpuProfiler::STAT_COUNT] = {
+    GL_VERTICES_SUBMITTED_ARB,
+    GL_PRIMITIVES_SUBMITTED_ARB,
+    GL_VERTEX_SHADER_INVOCATIONS_ARB,
+    GL_FRAGMENT_SHADER_INVOCATIONS_ARB,
+    GL_CLIPPING_OUTPUT_PRIMITIVES_ARB
+};
+
+GpuProfiler::GpuProfiler()
+{
+    m_pipelineStatistics = GLEW_ARB_pipeline_statistics_query != 0;
+    for (Frame& frame : m_frames)
+        frame.elapsed = 0;
+    //Listed first in the stats
+    getHistory(FRAME_ZONE);
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for (Frame& frame : m_frames)
+    {
+        for (const Zone& zone : frame.zones)
+            releaseZone(zone);
+        if (frame.elapsed != 0)
+            m_freeQueries[POOL_TIME_ELAPSED].push_back(frame.elapsed);
+    }
+    for (const std::vector<GLuint>& queries : m_freeQueries)
+    {
+        if (!queries.empty())
+            glDeleteQueries((GLsizei)queries.size(), queries.data());
+    }
+}
+
+void GpuProfiler::BeginFrame()
+{
+    m_frame++;
+    Frame& frame = m_frames[m_frame % RING_SIZE];
+    collect(frame);
+
+    m_openZones.clear();
+    m_statisticsDepth = -1;
+    frame.elapsed = allocateQuery(POOL_TIME_ELAPSED);
+    glBeginQuery(GL_TIME_ELAPSED, frame.elapsed);
+}
+
+void GpuProfiler::EndFrame()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+void GpuProfiler::BeginZone(const char* name)
+{
+    Frame& frame = m_frames[m_frame % RING_SIZE];
+    Zone zone = {};
+    zone.history = getHistory(name);
+    zone.begin = allocateQuery(POOL_TIMESTAMP);
+    glQueryCounter(zone.begin, GL_TIMESTAMP);
+
+    //Queries of one target can't nest, so only the outermost zone counts
+    if (m_pipelineStatistics && m_statisticsDepth < 0) {
+        m_statisticsDepth = (int)m_openZones.size();
+        for (int i = 0; i < STAT_COUNT; i++)
+        {
+            zone.statistics[i] = allocateQuery((QueryPool)(POOL_STATISTICS + i));
+            glBeginQuery(STATISTIC_TARGETS[i], zone.statistics[i]);
+        }
+    }
+
+    m_openZones.push_back(frame.zones.size());
+    frame.zones.push_back(zone);
+}
+
+void GpuProfiler::EndZone()
+{
+    Frame& frame = m_frames[m_frame % RING_SIZE];
+    Zone& zone = frame.zones[m_openZones.back()];
+    m_openZones.pop_back();
+
+    zone.end = allocateQuery(POOL_TIMESTAMP);
+    glQueryCounter(zone.end, GL_TIMESTAMP);
+    if (m_statisticsDepth == (int)m_openZones.size()) {
+        for (int i = 0; i < STAT_COUNT; i++)
+            glEndQuery(STATISTIC_TARGETS[i]);
+        m_statisticsDepth = -1;
+    }
+}
+
+std::vector<GpuProfiler::ZoneStats> GpuProfiler::GetStats() const
+{
+    std::vector<ZoneStats> result;
+    std::vector<float> sorted;
+    for (const History& history : m_histories)
+    {
+        ZoneStats stats = {};
+        stats.name = history.name;
+        stats.samples = history.times.size();
+        if (!history.times.empty()) {
+            sorted = history.times;
+            std::sort(sorted.begin(), sorted.end());
+            float sum = 0.0f;
+            for (float time : sorted)
+                sum += time;
+            auto percentile = [&sorted](float p) {
+                return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+            };
+            stats.average = sum / sorted.size();
+            stats.p50 = percentile(0.50f);
+            stats.p95 = percentile(0.95f);
+            stats.p99 = percentile(0.99f);
+            stats.max = sorted.back();
+        }
+
+        size_t statisticsSamples = history.statistics.size() / STAT_COUNT;
+        stats.hasPipelineStatistics = statisticsSamples > 0;
+        for (size_t sample = 0; sample < statisticsSamples; sample++)
+        {
+            for (int i = 0; i < STAT_COUNT; i++)
+                stats.pipelineStatistics[i] += (double)history.statistics[sample * STAT_COUNT + i];
+        }
+        for (int i = 0; i < STAT_COUNT && statisticsSamples > 0; i++)
+            stats.pipelineStatistics[i] /= statisticsSamples;
+        result.push_back(stats);
+    }
+    return result;
+}
+
+bool GpuProfiler::WriteCSV(const char* path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+        return false;
+    file << "zone,samples,average_ms,p50_ms,p95_ms,p99_ms,max_ms,"
+        << "vertices,primitives,vertex_invocations,fragment_invocations,clipped_primitives\n";
+    for (const ZoneStats& stats : GetStats())
+    {
+        file << stats.name << ',' << stats.samples << ',' << stats.average << ',' << stats.p50 << ','
+            << stats.p95 << ',' << stats.p99 << ',' << stats.max;
+        for (int i = 0; i < STAT_COUNT; i++)
+        {
+            file << ',';
+            if (stats.hasPipelineStatistics)
+                file << stats.pipelineStatistics[i];
+        }
+        file << '\n';
+    }
+    return file.good();
+}
+
+GLuint GpuProfiler::allocateQuery(QueryPool pool)
+{
+    std::vector<GLuint>& queries = m_freeQueries[pool];
+    if (queries.empty()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        return query;
+    }
+    GLuint query = queries.back();
+    queries.pop_back();
+    return query;
+}
+
+void GpuProfiler::releaseZone(const Zone& zone)
+{
+    m_freeQueries[POOL_TIMESTAMP].push_back(zone.begin);
+    m_freeQueries[POOL_TIMESTAMP].push_back(zone.end);
+    for (int i = 0; i < STAT_COUNT; i++)
+    {
+        if (zone.statistics[i] != 0)
+            m_freeQueries[POOL_STATISTICS + i].push_back(zone.statistics[i]);
+    }
+}
+
+int GpuProfiler::getHistory(const char* name)
+{
+    auto it = m_historyIndices.find(name);
+    if (it != m_historyIndices.end())
+        return it->second;
+    History history = {};
+    history.name = name;
+    m_histories.push_back(history);
+    int index = (int)m_histories.size() - 1;
+    m_historyIndices[name] = index;
+    return index;
+}
+
+void GpuProfiler::addSample(int index, float time, const uint64_t* statistics)
+{
+    History& history = m_histories[index];
+    if (history.times.size() < HISTORY_SIZE)
+        history.times.push_back(time);
+    else
+        history.times[history.nextTime] = time;
+    history.nextTime = (history.nextTime + 1) % HISTORY_SIZE;
+
+    if (statistics == nullptr)
+        return;
+    if (history.statistics.size() < HISTORY_SIZE * STAT_COUNT)
+        history.statistics.insert(history.statistics.end(), statistics, statistics + STAT_COUNT);
+    else
+        std::copy(statistics, statistics + STAT_COUNT, history.statistics.begin() + history.nextStatistics * STAT_COUNT);
+    history.nextStatistics = (history.nextStatistics + 1) % HISTORY_SIZE;
+}
+
+void GpuProfiler::collect(Frame& frame)
+{
+    //Never wait for a result. Late ones are only missing from the history
+    auto isAvailable = [](GLuint query) {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        return available == GL_TRUE;
+    };
+
+    for (const Zone& zone : frame.zones)
+    {
+        if (isAvailable(zone.begin) && isAvailable(zone.end)) {
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(zone.begin, GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(zone.end, GL_QUERY_RESULT, &end);
+            uint64_t statistics[STAT_COUNT];
+            bool hasStatistics = zone.statistics[0] != 0;
+            for (int i = 0; i < STAT_COUNT && hasStatistics; i++)
+            {
+                if (!isAvailable(zone.statistics[i])) {
+                    hasStatistics = false;
+                    break;
+                }
+                GLuint64 value = 0;
+                glGetQueryObjectui64v(zone.statistics[i], GL_QUERY_RESULT, &value);
+                statistics[i] = value;
+            }
+            addSample(zone.history, (float)((end - begin) / 1000000.0), hasStatistics ? statistics : nullptr);
+        }
+        else {
+            m_lateResults++;
+        }
+
+        releaseZone(zone);
+    }
+    frame.zones.clear();
+
+    if (frame.elapsed == 0)
+        return;
+    if (isAvailable(frame.elapsed)) {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(frame.elapsed, GL_QUERY_RESULT, &elapsed);
+        addSample(getHistory(FRAME_ZONE), (float)(elapsed / 1000000.0), nullptr);
+    }
+    else {
+        m_lateResults++;
+    }
+    m_freeQueries[POOL_TIME_ELAPSED].push_back(frame.elapsed);
+    frame.elapsed = 0;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Measures GPU time of named zones, e.g. render passes, with timestamp queries around them, and of the whole
+/// frame with a GL_TIME_ELAPSED query. Zones may nest. Results are read RING_SIZE frames later, once the GPU
+/// has them, so the CPU never waits. Where ARB_pipeline_statistics_query is supported, outermost zones also count
+/// vertices, primitives and shader invocations.
+/// Each zone keeps its last HISTORY_SIZE samples for averages and percentiles.
+/// </summary>
+class GpuProfiler {
+public:
+    //Frames a query stays in flight before its result is read
+    static const unsigned int RING_SIZE = 4;
+    //Samples kept per zone
+    static const size_t HISTORY_SIZE = 240;
+
+    enum PipelineStatistic {
+        STAT_VERTICES,
+        STAT_PRIMITIVES,
+        STAT_VERTEX_INVOCATIONS,
+        STAT_FRAGMENT_INVOCATIONS,
+        STAT_CLIPPED_PRIMITIVES,
+        STAT_COUNT
+    };
+
+    //Summary of a zone's history. Times in milliseconds, statistics are averages per frame
+    struct ZoneStats {
+        std::string name;
+        size_t samples;
+        float average;
+        float p50;
+        float p95;
+        float p99;
+        float max;
+        bool hasPipelineStatistics;
+        double pipelineStatistics[STAT_COUNT];
+    };
+
+    //Times a zone for the lifetime of the scope
+    class Scope {
+    public:
+        Scope(GpuProfiler& profiler, const char* name) : m_profiler(profiler) { m_profiler.BeginZone(name); }
+        ~Scope() { m_profiler.EndZone(); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        GpuProfiler& m_profiler;
+    };
+
+    //Name of the zone covering everything between BeginFrame and EndFrame
+    static const char* const FRAME_ZONE;
+
+    GpuProfiler();
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+    ~GpuProfiler();
+
+    //Reads the results of the frame issued RING_SIZE frames ago and starts timing the frame
+    void BeginFrame();
+    void EndFrame();
+    void BeginZone(const char* name);
+    void EndZone();
+
+    //One entry per zone seen so far, in the order they first appeared
+    std::vector<ZoneStats> GetStats() const;
+    //Writes GetStats() as comma separated values with a header line. Returns false if the file can't be written
+    bool WriteCSV(const char* path) const;
+
+    inline bool HasPipelineStatistics() const { return m_pipelineStatistics; }
+    //Results that hadn't arrived after RING_SIZE frames and were dropped, in total
+    inline size_t GetLateCount() const { return m_lateResults; }
+private:
+    struct Zone {
+        int history;
+        GLuint begin;
+        GLuint end;
+        //All 0 unless statistics were collected
+        GLuint statistics[STAT_COUNT];
+    };
+    struct Frame {
+        std::vector<Zone> zones;
+        //GL_TIME_ELAPSED over the frame, 0 if the frame wasn't timed
+        GLuint elapsed;
+    };
+    struct History {
+        std::string name;
+        //Rings of times in milliseconds and of STAT_COUNT statistics per sample, filled up to HISTORY_SIZE samples
+        std::vector<float> times;
+        std::vector<uint64_t> statistics;
+        size_t nextTime;
+        size_t nextStatistics;
+    };
+    //GL fixes a query's target on first use, so each target recycles its own queries.
+    //Statistic i uses POOL_STATISTICS + i
+    enum QueryPool {
+        POOL_TIMESTAMP,
+        POOL_TIME_ELAPSED,
+        POOL_STATISTICS,
+        POOL_COUNT = POOL_STATISTICS + STAT_COUNT
+    };
+
+    Frame m_frames[RING_SIZE];
+    unsigned int m_frame = 0;
+    //Open zones of the current frame, innermost last
+    std::vector<size_t> m_openZones;
+    //Depth of the zone collecting pipeline statistics, -1 if none
+    int m_statisticsDepth = -1;
+    std::vector<GLuint> m_freeQueries[POOL_COUNT];
+    std::vector<History> m_histories;
+    std::unordered_map<std::string, int> m_historyIndices;
+    bool m_pipelineStatistics;
+    size_t m_lateResults = 0;
+
+    GLuint allocateQuery(QueryPool pool);
+    //Returns the queries of zone to their pools
+    void releaseZone(const Zone& zone);
+    int getHistory(const char* name);
+    void addSample(int history, float time, const uint64_t* statistics);
+    //Reads the results of frame that have arrived and recycles all its queries
+    void collect(Frame& frame);
+};
@@ -0,0 +1,135 @@
+#include "JobSystem.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::vector<std::thread> s_workers;
+std::mutex s_mutex;
+std::condition_variable s_wake;
+std::condition_variable s_done;
+//Only one ParallelFor runs at a time
+std::mutex s_callMutex;
+
+//Current job. Written under s_mutex before workers are woken
+const std::function<void(size_t, size_t)>* s_job = nullptr;
+size_t s_count = 0;
+size_t s_batchSize = 1;
+std::atomic<size_t> s_next(0);
+//Bumped for every job so each worker runs it exactly once
+unsigned int s_generation = 0;
+unsigned int s_busyWorkers = 0;
+bool s_quit = false;
+
+thread_local bool t_isWorker = false;
+thread_local unsigned int t_threadIndex = 0;
+
+}
+
+void JobSystem::Initialize(unsigned int threadCount)
+{
+    if (!s_workers.empty())
+        return;
+    if (threadCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+    s_quit = false;
+    for (unsigned int i = 0; i < threadCount; i++)
+        s_workers.emplace_back(workerLoop, i + 1, s_generation);
+}
+
+void JobSystem::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_quit = true;
+    }
+    s_wake.notify_all();
+    for (std::thread& worker : s_workers)
+        worker.join();
+    s_workers.clear();
+}
+
+unsigned int JobSystem::GetThreadCount()
+{
+    return (unsigned int)s_workers.size() + 1;
+}
+
+unsigned int JobSystem::GetThreadIndex()
+{
+    return t_threadIndex;
+}
+
+void JobSystem::ParallelFor(size_t count, size_t minBatchSize, const std::function<void(size_t, size_t)>& job)
+{
+    if (count == 0)
+        return;
+    minBatchSize = std::max(minBatchSize, (size_t)1);
+    if (s_workers.empty() || t_isWorker || count <= minBatchSize) {
+        job(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> callLock(s_callMutex);
+    //A few ranges per thread evens out uneven work
+    size_t batchesWanted = GetThreadCount() * 4;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_job = &job;
+        s_count = count;
+        s_batchSize = std::max(minBatchSize, (count + batchesWanted - 1) / batchesWanted);
+        s_next = 0;
+        s_busyWorkers = (unsigned int)s_workers.size();
+        s_generation++;
+    }
+    s_wake.notify_all();
+
+    runBatches();
+
+    std::unique_lock<std::mutex> lock(s_mutex);
+    s_done.wait(lock, [] { return s_busyWorkers == 0; });
+    s_job = nullptr;
+}
+
+void JobSystem::workerLoop(unsigned int threadIndex, unsigned int seenGeneration)
+{
+    t_isWorker = true;
+    t_threadIndex = threadIndex;
+    CPU_PROFILE_THREAD(("Worker " + std::to_string(threadIndex)).c_str());
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(s_mutex);
+            s_wake.wait(lock, [&seenGeneration] { return s_quit || s_generation != seenGeneration; });
+            if (s_quit)
+                return;
+            seenGeneration = s_generation;
+        }
+
+        runBatches();
+
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if (--s_busyWorkers == 0)
+            s_done.notify_one();
+    }
+}
+
+void JobSystem::runBatches()
+{
+    while (true)
+    {
+        size_t begin = s_next.fetch_add(s_batchSize);
+        if (begin >= s_count)
+            return;
+        CPU_PROFILE_ZONE("Job");
+        (*s_job)(begin, std::min(begin + s_batchSize, s_count));
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+/// <summary>
+/// Fixed pool of worker threads for splitting loops across cores.
+/// The calling thread takes part in every ParallelFor, so a pool of N workers runs on N + 1 threads.
+/// Without Initialize, or when called from inside a job, ParallelFor runs the whole range on the calling thread.
+/// </summary>
+class JobSystem {
+public:
+    //Starts threadCount workers. 0 uses one less than the number of hardware threads
+    static void Initialize(unsigned int threadCount = 0);
+    //Joins all workers. Must be called before exit, since running threads can't be destroyed
+    static void Shutdown();
+    //Workers plus the calling thread
+    static unsigned int GetThreadCount();
+    //0 on the thread that calls ParallelFor, 1 to GetThreadCount() - 1 on workers. Indexes per-thread data inside jobs
+    static unsigned int GetThreadIndex();
+    /// <summary>
+    /// Calls job(begin, end) over ranges of [0, count) on all threads and returns once every range is done.
+    /// Ranges hold at least minBatchSize items, so small loops don't pay for waking workers
+    /// </summary>
+    static void ParallelFor(size_t count, size_t minBatchSize, const std::function<void(size_t, size_t)>& job);
+private:
+    //Runs every job started after generation
+    static void workerLoop(unsigned int threadIndex, unsigned int generation);
+    //Takes ranges of the current job until none are left
+    static void runBatches();
+};
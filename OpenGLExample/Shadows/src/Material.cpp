@@ -0,0 +1,83 @@
+#include "Material.h"
+#include "GLStateCache.h"
+
+unsigned int Material::s_bindCount = 0;
+unsigned int Material::s_lastBindCount = 0;
+
+Material::Material(GLuint albedoTexture, const glm::vec2& tile, float shininess, float reflectivity)
+    : m_buffer(sizeof(MaterialData), MATERIAL_DATA_BINDING)
+{
+    m_data.tile = tile;
+    m_data.shininess = shininess;
+    m_data.reflectivity = reflectivity;
+    m_data.ambientK = 0.3f;
+    m_data.diffuseK = 0.7f;
+    m_data.specularK = 0.3f;
+    m_data.pad0 = 0.0f;
+    SetTexture(0, GL_TEXTURE_2D, albedoTexture);
+}
+
+void Material::SetTexture(unsigned int unit, GLenum target, GLuint texture)
+{
+    for (TextureBinding& binding : m_textures)
+    {
+        if (binding.unit == unit) {
+            binding.target = target;
+            binding.texture = texture;
+            return;
+        }
+    }
+    m_textures.push_back({ unit, target, texture });
+}
+
+void Material::SetTile(const glm::vec2& tile)
+{
+    m_data.tile = tile;
+    m_dirty = true;
+}
+
+void Material::SetShininess(float shininess)
+{
+    m_data.shininess = shininess;
+    m_dirty = true;
+}
+
+void Material::SetReflectivity(float reflectivity)
+{
+    m_data.reflectivity = reflectivity;
+    m_dirty = true;
+}
+
+void Material::SetAmbient(float ambient)
+{
+    m_data.ambientK = ambient;
+    m_dirty = true;
+}
+
+void Material::SetDiffuse(float diffuse)
+{
+    m_data.diffuseK = diffuse;
+    m_dirty = true;
+}
+
+void Material::SetSpecular(float specular)
+{
+    m_data.specularK = specular;
+    m_dirty = true;
+}
+
+void Material::Bind()
+{
+    s_bindCount++;
+    if (m_dirty) {
+        m_buffer.SetData(&m_data, sizeof(MaterialData));
+        m_dirty = false;
+    }
+    m_buffer.Bind();
+
+    for (const TextureBinding& binding : m_textures)
+    {
+        GLStateCache::ActiveTexture(GL_TEXTURE0 + binding.unit);
+        GLStateCache::BindTexture(binding.target, binding.texture);
+    }
+}
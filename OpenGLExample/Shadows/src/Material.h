@@ -0,0 +1,61 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "UniformBuffer.h"
+#include "UniformBlocks.h"
+
+/// <summary>
+/// Surface parameters and textures shared by every object drawn with it.
+/// Constants live in a uniform buffer owned by the material, which is only re-uploaded when a value changes,
+/// so drawing a batch of objects with the same material costs one Bind().
+/// </summary>
+class Material {
+public:
+    /// <param name="albedoTexture">2D texture bound to unit 0 (u_texture)</param>
+    Material(GLuint albedoTexture, const glm::vec2& tile = glm::vec2(1.0f), float shininess = 32.0f, float reflectivity = 0.0f);
+    Material(const Material&) = delete;
+    Material& operator=(const Material&) = delete;
+
+    /// <summary>
+    /// Adds or replaces the texture bound to unit (0-based) when the material is bound
+    /// </summary>
+    void SetTexture(unsigned int unit, GLenum target, GLuint texture);
+    void SetTile(const glm::vec2& tile);
+    void SetShininess(float shininess);
+    void SetReflectivity(float reflectivity);
+    //Weights of the lighting terms. Default to 0.3 ambient, 0.7 diffuse and 0.3 specular
+    void SetAmbient(float ambient);
+    void SetDiffuse(float diffuse);
+    void SetSpecular(float specular);
+    //Shader variant features the material needs, as a ShaderVariants feature mask. 0 by default.
+    //Draws use the variant with these features, limited to what the pass allows
+    inline void SetShaderFeatures(unsigned int features) { m_shaderFeatures = features; }
+    inline unsigned int GetShaderFeatures() const { return m_shaderFeatures; }
+    inline const MaterialData& GetData() const { return m_data; }
+
+    /// <summary>
+    /// Uploads pending changes, then binds the material's uniform buffer and textures through GLStateCache
+    /// </summary>
+    void Bind();
+    //Moves this frame's bind count to the last frame value and resets it
+    inline static void BeginFrame() { s_lastBindCount = s_bindCount; s_bindCount = 0; }
+    //Bind() calls of all materials last frame
+    inline static unsigned int GetBindCount() { return s_lastBindCount; }
+private:
+    struct TextureBinding {
+        unsigned int unit;
+        GLenum target;
+        GLuint texture;
+    };
+
+    MaterialData m_data;
+    UniformBuffer m_buffer;
+    bool m_dirty = true;
+    unsigned int m_shaderFeatures = 0;
+    std::vector<TextureBinding> m_textures;
+    static unsigned int s_bindCount;
+    static unsigned int s_lastBindCount;
+};
@@ -0,0 +1,83 @@
+#include "OcclusionBenchmark.h"
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include "Timer.h"
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+const size_t NUM_BOXES = 100000;
+const int NUM_FRAMES = 100;
+
+//Unit quad in the XY plane, with both windings so it occludes from either side
+MeshData createWallMesh()
+{
+    MeshData mesh;
+    glm::vec3 corners[4] = { glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.5f, -0.5f, 0.0f), glm::vec3(0.5f, 0.5f, 0.0f), glm::vec3(-0.5f, 0.5f, 0.0f) };
+    for (const glm::vec3& corner : corners)
+        mesh.vertices.push_back({ corner, glm::vec3(1.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(0.0f) });
+    mesh.indices = { 0, 1, 2, 0, 2, 3, 0, 2, 1, 0, 3, 2 };
+    return mesh;
+}
+
+}
+
+void RunOcclusionBenchmark()
+{
+    //Camera at the origin looking down +Z at a 16x16 wall 10 units away
+    glm::mat4 viewProjection = glm::perspective(glm::radians(90.0f), 2.0f, 0.1f, 100.0f)
+        * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    MeshData wall = createWallMesh();
+    glm::mat4 wallModel = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 10.0f)), glm::vec3(16.0f, 16.0f, 1.0f));
+
+    //Half the boxes between camera and wall, half well inside the wall's shadow
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> lateral(-4.0f, 4.0f);
+    std::uniform_real_distribution<float> frontDepth(2.0f, 8.0f);
+    std::uniform_real_distribution<float> backDepth(12.0f, 60.0f);
+    std::vector<AABB> boxes(NUM_BOXES);
+    for (size_t i = 0; i < NUM_BOXES; i++)
+    {
+        bool behind = i >= NUM_BOXES / 2;
+        glm::vec3 center = glm::vec3(lateral(rng), lateral(rng), behind ? backDepth(rng) : frontDepth(rng));
+        boxes[i] = { center - glm::vec3(0.25f), center + glm::vec3(0.25f) };
+    }
+
+    OcclusionCuller culler;
+    float rasterizeTime = 0.0f;
+    float testTime = 0.0f;
+    std::vector<uint8_t> visible;
+    for (int frame = 0; frame < NUM_FRAMES; frame++)
+    {
+        culler.BeginFrame(viewProjection);
+        culler.AddOccluder(wall, wallModel);
+        culler.Rasterize();
+        rasterizeTime += culler.GetRasterizeTime();
+
+        visible.assign(NUM_BOXES, 1);
+        Timer testTimer;
+        culler.Cull(boxes, visible);
+        testTime += testTimer.ElapsedMs();
+    }
+
+    size_t keptInFront = 0, culledBehind = 0;
+    for (size_t i = 0; i < NUM_BOXES; i++)
+    {
+        if (i < NUM_BOXES / 2)
+            keptInFront += visible[i];
+        else
+            culledBehind += 1 - visible[i];
+    }
+
+    std::cout << "Occlusion culling, " << culler.GetWidth() << "x" << culler.GetHeight() << " depth buffer, "
+        << JobSystem::GetThreadCount() << " threads, " << OcclusionCuller::GetBatchWidth() << " pixels per fill" << std::endl;
+    std::cout << "  rasterize " << culler.GetTriangleCount() << " triangles: " << rasterizeTime / NUM_FRAMES << " ms" << std::endl;
+    std::cout << "  test " << NUM_BOXES << " boxes: " << testTime / NUM_FRAMES << " ms" << std::endl;
+    std::cout << "  boxes in front kept: " << keptInFront << " of " << NUM_BOXES / 2 << std::endl;
+    std::cout << "  boxes behind culled: " << culledBehind << " of " << NUM_BOXES - NUM_BOXES / 2 << std::endl;
+}
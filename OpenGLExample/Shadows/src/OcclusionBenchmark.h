@@ -0,0 +1,8 @@
+#pragma once
+
+/// <summary>
+/// Rasterizes a wall with OcclusionCuller and tests 100K boxes in front of and behind it.
+/// Prints timings and how many boxes were culled correctly. CPU only, needs no GL context.
+/// Run with the --benchmark-occlusion command line argument.
+/// </summary>
+void RunOcclusionBenchmark();
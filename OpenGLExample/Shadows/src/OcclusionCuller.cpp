@@ -0,0 +1,403 @@
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE2
+#endif
+
+//Rows per job, so threads don't fight over the same cache lines
+const int ROWS_PER_BATCH = 8;
+//Boxes per job when testing
+const size_t BOXES_PER_BATCH = 256;
+//Depth difference up to which two triangles sharing an edge count as one face and are merged into a quad
+const float COPLANAR_EPSILON = 1e-5f;
+
+OcclusionCuller::OcclusionCuller(int width, int height) : m_width(width), m_height(height)
+{
+    //Fill works on groups of 4 pixels that must not wrap into the next row
+    m_width = std::max(4, (m_width + 3) & ~3);
+    glm::ivec2 size = glm::ivec2(m_width, m_height);
+    while (true)
+    {
+        m_levelSizes.push_back(size);
+        m_levels.push_back(std::vector<float>((size_t)size.x * size.y, 1.0f));
+        if (size.x == 1 && size.y == 1)
+            break;
+        size = glm::max((size + 1) / 2, glm::ivec2(1));
+    }
+}
+
+void OcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+{
+    m_viewProjection = viewProjection;
+    m_polygons.clear();
+    m_triangleCount = 0;
+}
+
+void OcclusionCuller::AddOccluder(const MeshData& mesh, const glm::mat4& model)
+{
+    glm::mat4 mvp = m_viewProjection * model;
+    size_t vertexCount = mesh.vertices.size();
+    std::vector<glm::vec4> clipPositions(vertexCount);
+    //Pixel coordinates of the vertices between the near and far planes, which need no clipping
+    std::vector<glm::vec3> screenPositions(vertexCount);
+    std::vector<uint8_t> unclipped(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+    {
+        const glm::vec4& clip = clipPositions[i] = mvp * glm::vec4(mesh.vertices[i].position, 1.0f);
+        unclipped[i] = clip.w > 0.0f && clip.z >= -clip.w && clip.z <= clip.w;
+        if (unclipped[i])
+            screenPositions[i] = toScreen(clip);
+    }
+
+    //Unclipped front facing triangles, looked up by their directed edges to find the neighbour sharing one
+    std::vector<size_t> candidates;
+    std::unordered_map<uint64_t, size_t> edges;
+    auto edgeKey = [](uint32_t from, uint32_t to) { return ((uint64_t)from << 32) | to; };
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        const unsigned int* index = &mesh.indices[i];
+        if (!unclipped[index[0]] || !unclipped[index[1]] || !unclipped[index[2]]) {
+            addTriangle(clipPositions[index[0]], clipPositions[index[1]], clipPositions[index[2]]);
+            continue;
+        }
+        const glm::vec3& v0 = screenPositions[index[0]];
+        const glm::vec3& v1 = screenPositions[index[1]];
+        const glm::vec3& v2 = screenPositions[index[2]];
+        if ((v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y) <= 0.0f)
+            continue;
+        for (int edge = 0; edge < 3; edge++)
+            edges.emplace(edgeKey(index[edge], index[(edge + 1) % 3]), candidates.size());
+        candidates.push_back(i);
+    }
+
+    std::vector<uint8_t> used(candidates.size(), 0);
+    for (size_t candidate = 0; candidate < candidates.size(); candidate++)
+    {
+        if (used[candidate])
+            continue;
+        used[candidate] = 1;
+        const unsigned int* index = &mesh.indices[candidates[candidate]];
+        glm::vec3 triangle[3] = { screenPositions[index[0]], screenPositions[index[1]], screenPositions[index[2]] };
+        m_triangleCount++;
+
+        bool merged = false;
+        for (int edge = 0; edge < 3 && !merged; edge++)
+        {
+            unsigned int from = index[edge], to = index[(edge + 1) % 3];
+            auto it = edges.find(edgeKey(to, from));
+            if (it == edges.end() || used[it->second])
+                continue;
+            const unsigned int* other = &mesh.indices[candidates[it->second]];
+            unsigned int opposite = other[0] + other[1] + other[2] - from - to;
+
+            //The neighbour's far vertex goes between the shared ones, keeping the order counter clockwise
+            glm::vec3 quad[4] = { screenPositions[from], screenPositions[opposite], screenPositions[to], triangle[(edge + 2) % 3] };
+            bool convex = true;
+            for (int i = 0; i < 4 && convex; i++)
+            {
+                glm::vec3 a = quad[(i + 3) % 4], b = quad[i], c = quad[(i + 1) % 4];
+                convex = (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x) > 0.0f;
+            }
+            if (!convex)
+                continue;
+
+            //Depth of the 4th vertex against the plane of the other three. Small differences from rounding are
+            //covered by biasing the plane, anything larger isn't one face
+            glm::vec3 a = quad[0], b = quad[1], c = quad[2];
+            float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+            float dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+            float dzdy = ((b.x - a.x) * (c.z - a.z) - (c.x - a.x) * (b.z - a.z)) / area;
+            float offPlane = std::abs(a.z + dzdx * (quad[3].x - a.x) + dzdy * (quad[3].y - a.y) - quad[3].z);
+            if (offPlane > COPLANAR_EPSILON)
+                continue;
+
+            used[it->second] = 1;
+            m_triangleCount++;
+            setupPolygon(quad, 4, offPlane);
+            merged = true;
+        }
+        if (!merged)
+            setupPolygon(triangle, 3);
+    }
+}
+
+glm::vec3 OcclusionCuller::toScreen(const glm::vec4& clip) const
+{
+    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    return glm::vec3((ndc.x * 0.5f + 0.5f) * m_width, (ndc.y * 0.5f + 0.5f) * m_height, ndc.z * 0.5f + 0.5f);
+}
+
+void OcclusionCuller::addTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+    //Outside one of the side or far planes
+    const glm::vec4* vertices[3] = { &a, &b, &c };
+    for (int axis = 0; axis < 3; axis++)
+    {
+        bool allBelow = true, allAbove = true;
+        for (const glm::vec4* v : vertices)
+        {
+            allBelow = allBelow && (*v)[axis] < -v->w;
+            allAbove = allAbove && (*v)[axis] > v->w;
+        }
+        //Near side of z is clipped below instead
+        if ((allBelow && axis != 2) || allAbove)
+            return;
+    }
+
+    //Clip against the near plane (z = -w), which leaves at most 4 vertices
+    glm::vec4 polygon[4];
+    int count = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        const glm::vec4& current = *vertices[i];
+        const glm::vec4& next = *vertices[(i + 1) % 3];
+        float currentDistance = current.z + current.w;
+        float nextDistance = next.z + next.w;
+        if (currentDistance >= 0.0f)
+            polygon[count++] = current;
+        if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+            polygon[count++] = glm::mix(current, next, currentDistance / (currentDistance - nextDistance));
+    }
+    if (count < 3)
+        return;
+
+    //What is left is convex and planar, so it is drawn as one polygon
+    glm::vec3 screen[4];
+    for (int i = 0; i < count; i++)
+        screen[i] = toScreen(polygon[i]);
+    m_triangleCount++;
+    setupPolygon(screen, count);
+}
+
+void OcclusionCuller::setupPolygon(const glm::vec3* vertices, int count, float depthBias)
+{
+    //Counter clockwise is front facing, like GL's default. The first three vertices give the depth plane
+    const glm::vec3& v0 = vertices[0];
+    const glm::vec3& v1 = vertices[1];
+    const glm::vec3& v2 = vertices[2];
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (area <= 0.0f)
+        return;
+
+    glm::vec2 minimum = glm::vec2(v0), maximum = glm::vec2(v0);
+    for (int i = 1; i < count; i++)
+    {
+        minimum = glm::min(minimum, glm::vec2(vertices[i]));
+        maximum = glm::max(maximum, glm::vec2(vertices[i]));
+    }
+    Polygon polygon;
+    polygon.minX = std::max((int)std::floor(minimum.x), 0);
+    polygon.maxX = std::min((int)std::ceil(maximum.x), m_width - 1);
+    polygon.minY = std::max((int)std::floor(minimum.y), 0);
+    polygon.maxY = std::min((int)std::ceil(maximum.y), m_height - 1);
+    if (polygon.minX > polygon.maxX || polygon.minY > polygon.maxY)
+        return;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (i >= count) {
+            polygon.edgeA[i] = 0.0f;
+            polygon.edgeB[i] = 0.0f;
+            polygon.edgeC[i] = 1.0f;
+            continue;
+        }
+        const glm::vec3& from = vertices[i];
+        const glm::vec3& to = vertices[(i + 1) % count];
+        polygon.edgeA[i] = from.y - to.y;
+        polygon.edgeB[i] = to.x - from.x;
+        polygon.edgeC[i] = -(polygon.edgeA[i] * from.x + polygon.edgeB[i] * from.y);
+        //Pixels are tested at their center. Moving each edge in by half a pixel along both axes
+        //only passes pixels the polygon covers completely, so a box poking out past the edge is never hidden
+        polygon.edgeC[i] -= 0.5f * (std::abs(polygon.edgeA[i]) + std::abs(polygon.edgeB[i]));
+    }
+
+    polygon.dzdx = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+    polygon.dzdy = ((v1.x - v0.x) * (v2.z - v0.z) - (v2.x - v0.x) * (v1.z - v0.z)) / area;
+    polygon.z0 = v0.z - polygon.dzdx * v0.x - polygon.dzdy * v0.y;
+    //Likewise store the farthest depth over the pixel instead of the one at its center
+    polygon.z0 += 0.5f * (std::abs(polygon.dzdx) + std::abs(polygon.dzdy)) + depthBias;
+    m_polygons.push_back(polygon);
+}
+
+void OcclusionCuller::Rasterize()
+{
+    Timer timer;
+
+    std::fill(m_levels[0].begin(), m_levels[0].end(), 1.0f);
+    int numBatches = (m_height + ROWS_PER_BATCH - 1) / ROWS_PER_BATCH;
+    JobSystem::ParallelFor(numBatches, 1, [this](size_t begin, size_t end) {
+        int minY = (int)begin * ROWS_PER_BATCH;
+        int maxY = std::min((int)end * ROWS_PER_BATCH, m_height) - 1;
+        rasterizeRows(minY, maxY);
+    });
+    buildPyramid();
+
+    m_rasterizeTime = timer.ElapsedMs();
+}
+
+void OcclusionCuller::rasterizeRows(int minY, int maxY)
+{
+    float* depth = m_levels[0].data();
+    for (const Polygon& polygon : m_polygons)
+    {
+        int startY = std::max(polygon.minY, minY);
+        int endY = std::min(polygon.maxY, maxY);
+        //Groups of 4 start on a multiple of 4 so they never cross the row end
+        int startX = polygon.minX & ~3;
+        for (int y = startY; y <= endY; y++)
+        {
+            float pixelY = y + 0.5f;
+            float* row = depth + (size_t)y * m_width;
+#if defined(OCCLUSION_CULLER_SSE2)
+            __m128 pixelX = _mm_add_ps(_mm_set1_ps((float)startX), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+            __m128 step = _mm_set1_ps(4.0f);
+            __m128 edge[4], edgeStep[4];
+            for (int i = 0; i < 4; i++)
+            {
+                __m128 a = _mm_set1_ps(polygon.edgeA[i]);
+                edge[i] = _mm_add_ps(_mm_mul_ps(a, pixelX), _mm_set1_ps(polygon.edgeB[i] * pixelY + polygon.edgeC[i]));
+                edgeStep[i] = _mm_mul_ps(a, step);
+            }
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(polygon.dzdx), pixelX), _mm_set1_ps(polygon.z0 + polygon.dzdy * pixelY));
+            __m128 zStep = _mm_set1_ps(polygon.dzdx * 4.0f);
+            __m128 zero = _mm_setzero_ps();
+            for (int x = startX; x <= polygon.maxX; x += 4)
+            {
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge[0], zero), _mm_cmpge_ps(edge[1], zero)),
+                    _mm_and_ps(_mm_cmpge_ps(edge[2], zero), _mm_cmpge_ps(edge[3], zero)));
+                if (_mm_movemask_ps(inside) != 0) {
+                    __m128 current = _mm_loadu_ps(row + x);
+                    __m128 nearest = _mm_min_ps(current, z);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+                }
+                for (int i = 0; i < 4; i++)
+                    edge[i] = _mm_add_ps(edge[i], edgeStep[i]);
+                z = _mm_add_ps(z, zStep);
+            }
+#else
+            for (int x = polygon.minX; x <= polygon.maxX; x++)
+            {
+                float pixelX = x + 0.5f;
+                bool inside = true;
+                for (int i = 0; i < 4; i++)
+                    inside = inside && polygon.edgeA[i] * pixelX + polygon.edgeB[i] * pixelY + polygon.edgeC[i] >= 0.0f;
+                if (inside)
+                    row[x] = std::min(row[x], polygon.z0 + polygon.dzdx * pixelX + polygon.dzdy * pixelY);
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::buildPyramid()
+{
+    for (size_t level = 1; level < m_levels.size(); level++)
+    {
+        const std::vector<float>& source = m_levels[level - 1];
+        glm::ivec2 sourceSize = m_levelSizes[level - 1];
+        glm::ivec2 size = m_levelSizes[level];
+        std::vector<float>& target = m_levels[level];
+        for (int y = 0; y < size.y; y++)
+        {
+            //Odd sizes repeat the last row or column
+            int y0 = std::min(y * 2, sourceSize.y - 1), y1 = std::min(y * 2 + 1, sourceSize.y - 1);
+            for (int x = 0; x < size.x; x++)
+            {
+                int x0 = std::min(x * 2, sourceSize.x - 1), x1 = std::min(x * 2 + 1, sourceSize.x - 1);
+                target[(size_t)y * size.x + x] = std::max(
+                    std::max(source[(size_t)y0 * sourceSize.x + x0], source[(size_t)y0 * sourceSize.x + x1]),
+                    std::max(source[(size_t)y1 * sourceSize.x + x0], source[(size_t)y1 * sourceSize.x + x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::IsVisible(const AABB& box) const
+{
+    glm::vec2 screenMin = glm::vec2(FLT_MAX);
+    glm::vec2 screenMax = glm::vec2(-FLT_MAX);
+    float nearestDepth = FLT_MAX;
+    //Corners are the min corner plus any combination of the box's edges, so only one full transform is needed
+    glm::vec3 size = box.max - box.min;
+    glm::vec4 origin = m_viewProjection * glm::vec4(box.min, 1.0f);
+    glm::vec4 edgeX = m_viewProjection[0] * size.x;
+    glm::vec4 edgeY = m_viewProjection[1] * size.y;
+    glm::vec4 edgeZ = m_viewProjection[2] * size.z;
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec4 clip = origin;
+        if (i & 1)
+            clip += edgeX;
+        if (i & 2)
+            clip += edgeY;
+        if (i & 4)
+            clip += edgeZ;
+        //Crosses the near plane, its projection is unbounded
+        if (clip.z < -clip.w || clip.w <= 0.0f)
+            return true;
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        screenMin = glm::min(screenMin, glm::vec2(ndc));
+        screenMax = glm::max(screenMax, glm::vec2(ndc));
+        nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    //Pixels the box touches
+    glm::vec2 scale = glm::vec2(m_width, m_height) * 0.5f;
+    int minX = std::max((int)std::floor((screenMin.x + 1.0f) * scale.x), 0);
+    int maxX = std::min((int)std::floor((screenMax.x + 1.0f) * scale.x), m_width - 1);
+    int minY = std::max((int)std::floor((screenMin.y + 1.0f) * scale.y), 0);
+    int maxY = std::min((int)std::floor((screenMax.y + 1.0f) * scale.y), m_height - 1);
+    //Off screen. Frustum culling decides about these
+    if (minX > maxX || minY > maxY)
+        return true;
+
+    //Coarsest level where the box covers at most 2x2 texels
+    size_t level = 0;
+    while (level + 1 < m_levels.size() && ((maxX >> level) - (minX >> level) > 1 || (maxY >> level) - (minY >> level) > 1))
+        level++;
+
+    const std::vector<float>& depth = m_levels[level];
+    int levelWidth = m_levelSizes[level].x;
+    for (int y = minY >> level; y <= (maxY >> level); y++)
+    {
+        for (int x = minX >> level; x <= (maxX >> level); x++)
+        {
+            if (nearestDepth <= depth[(size_t)y * levelWidth + x])
+                return true;
+        }
+    }
+    return false;
+}
+
+size_t OcclusionCuller::Cull(const std::vector<AABB>& boxes, std::vector<uint8_t>& visible) const
+{
+    visible.resize(boxes.size(), 1);
+    size_t tested = std::count(visible.begin(), visible.end(), (uint8_t)1);
+    JobSystem::ParallelFor(boxes.size(), BOXES_PER_BATCH, [this, &boxes, &visible](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            if (visible[i] && !IsVisible(boxes[i]))
+                visible[i] = 0;
+        }
+    });
+
+    //Counted afterwards so jobs don't share a counter
+    return tested - std::count(visible.begin(), visible.end(), (uint8_t)1);
+}
+
+int OcclusionCuller::GetBatchWidth()
+{
+#if defined(OCCLUSION_CULLER_SSE2)
+    return 4;
+#else
+    return 1;
+#endif
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+#include "Primitive.h"
+
+/// <summary>
+/// Software occlusion culling on the CPU. A few large occluder meshes are rasterized into a small depth buffer,
+/// then a max depth pyramid (hierarchical Z) of it is built. A box is hidden if its nearest point is behind
+/// the farthest occluder depth over the pixels it covers. Needs no GL context.
+/// Occluders are rasterized conservatively: only pixels a polygon covers completely get its depth, at its farthest
+/// point in that pixel. Boxes are tested over every pixel they touch, so culling never hides a visible box.
+/// Pairs of coplanar triangles sharing an edge are drawn as one quad so no gap opens along the shared edge.
+/// Rows are split across JobSystem threads and pixels are filled 4 at a time with SSE2 when available.
+/// </summary>
+class OcclusionCuller {
+public:
+    OcclusionCuller(int width = 256, int height = 128);
+
+    //Clears the depth buffer and occluders. viewProjection is used for all following calls
+    void BeginFrame(const glm::mat4& viewProjection);
+    //Queues the triangles of mesh. Back faces and triangles off screen are dropped
+    void AddOccluder(const MeshData& mesh, const glm::mat4& model);
+    //Draws the queued occluders and builds the depth pyramid. Must be called before testing
+    void Rasterize();
+
+    //False if box is completely hidden. Boxes crossing the near plane are always visible
+    bool IsVisible(const AABB& box) const;
+    /// <summary>
+    /// Clears visible[i] for boxes hidden behind the occluders. Only boxes with visible[i] set are tested.
+    /// Returns the number of boxes culled
+    /// </summary>
+    size_t Cull(const std::vector<AABB>& boxes, std::vector<uint8_t>& visible) const;
+
+    inline int GetWidth() const { return m_width; }
+    inline int GetHeight() const { return m_height; }
+    //Depth buffer after Rasterize, row major from the bottom left, 0 near and 1 far
+    inline const std::vector<float>& GetDepthBuffer() const { return m_levels[0]; }
+    //Triangles that survived clipping and back face culling this frame
+    inline size_t GetTriangleCount() const { return m_triangleCount; }
+    inline float GetRasterizeTime() const { return m_rasterizeTime; }
+    //Pixels filled per SIMD instruction in this build
+    static int GetBatchWidth();
+private:
+    //Screen space setup of a convex polygon of 3 or 4 vertices. Each edge function is a * x + b * y + c, positive inside.
+    //Triangles fill the 4th edge with one that always passes
+    struct Polygon {
+        float edgeA[4];
+        float edgeB[4];
+        float edgeC[4];
+        //Depth plane: z = z0 + dzdx * x + dzdy * y
+        float z0;
+        float dzdx;
+        float dzdy;
+        int minX, maxX, minY, maxY;
+    };
+
+    int m_width;
+    int m_height;
+    glm::mat4 m_viewProjection;
+    std::vector<Polygon> m_polygons;
+    size_t m_triangleCount = 0;
+    //Level 0 is the depth buffer, each further level holds the max of 2x2 texels of the one before
+    std::vector<std::vector<float>> m_levels;
+    std::vector<glm::ivec2> m_levelSizes;
+    float m_rasterizeTime = 0.0f;
+
+    //Pixel coordinates with depth in [0, 1]
+    glm::vec3 toScreen(const glm::vec4& clip) const;
+    //Clips against the near plane and sets up what is left
+    void addTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+    //Vertices counter clockwise in pixel coordinates. depthBias is added to the depth plane,
+    //for quads whose 4th vertex is slightly off the plane of the first three
+    void setupPolygon(const glm::vec3* vertices, int count, float depthBias = 0.0f);
+    //Draws all polygons into rows [minY, maxY]
+    void rasterizeRows(int minY, int maxY);
+    void buildPyramid();
+};
@@ -0,0 +1,117 @@
+#include "OcclusionQueries.h"
+#include "Shader.h"
+#include "Primitive.h"
+#include "GLStateCache.h"
+
+#include <algorithm>
+
+//Proxies are grown a little so they aren't hidden by the surface of the object they surround
+const float PROXY_MARGIN = 0.01f;
+
+OcclusionQueries::~OcclusionQueries()
+{
+    for (Frame& frame : m_frames)
+    {
+        for (const Entry& entry : frame.entries)
+            glDeleteQueries(1, &entry.query);
+    }
+    if (!m_freeQueries.empty())
+        glDeleteQueries((GLsizei)m_freeQueries.size(), m_freeQueries.data());
+}
+
+void OcclusionQueries::BeginFrame()
+{
+    m_lastIssued = (unsigned int)m_frames[m_frame % RING_SIZE].entries.size();
+    m_frame++;
+    Frame& frame = m_frames[m_frame % RING_SIZE];
+
+    m_skippedDraws = 0;
+    m_pendingResults = 0;
+    for (const Entry& entry : frame.entries)
+    {
+        //Never wait for a result. Late ones are only missing from the statistics
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(entry.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            m_pendingResults++;
+        }
+        else if (entry.usedAsCondition) {
+            GLuint anySamplesPassed = GL_TRUE;
+            glGetQueryObjectuiv(entry.query, GL_QUERY_RESULT, &anySamplesPassed);
+            if (!anySamplesPassed)
+                m_skippedDraws++;
+        }
+        m_freeQueries.push_back(entry.query);
+    }
+    frame.entries.clear();
+    std::fill(frame.keyToEntry.begin(), frame.keyToEntry.end(), -1);
+}
+
+GLuint OcclusionQueries::GetCondition(size_t key)
+{
+    Frame& previous = m_frames[(m_frame + RING_SIZE - 1) % RING_SIZE];
+    if (key >= previous.keyToEntry.size() || previous.keyToEntry[key] < 0)
+        return 0;
+    Entry& entry = previous.entries[previous.keyToEntry[key]];
+    entry.usedAsCondition = true;
+    return entry.query;
+}
+
+void OcclusionQueries::BeginQueries(Shader& proxyShader, Primitive& proxyCube, const glm::vec3& cameraPosition)
+{
+    m_proxyShader = &proxyShader;
+    m_boxCenterUniform = proxyShader.getUniformHandle("u_boxCenter");
+    m_boxSizeUniform = proxyShader.getUniformHandle("u_boxSize");
+    m_proxyCube = &proxyCube;
+    m_cameraPosition = cameraPosition;
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    GLStateCache::Enable(GL_DEPTH_TEST);
+    GLStateCache::DepthFunc(GL_LEQUAL);
+    proxyShader.use();
+}
+
+void OcclusionQueries::Query(size_t key, const AABB& box)
+{
+    glm::vec3 min = box.min - glm::vec3(PROXY_MARGIN);
+    glm::vec3 max = box.max + glm::vec3(PROXY_MARGIN);
+    //Front faces would be clipped by the near plane
+    if (glm::all(glm::greaterThanEqual(m_cameraPosition, min)) && glm::all(glm::lessThanEqual(m_cameraPosition, max)))
+        return;
+
+    Frame& frame = m_frames[m_frame % RING_SIZE];
+    if (key >= frame.keyToEntry.size())
+        frame.keyToEntry.resize(key + 1, -1);
+    GLuint query = allocateQuery();
+    frame.keyToEntry[key] = (int)frame.entries.size();
+    frame.entries.push_back({ query, false });
+
+    m_proxyShader->setVec3(m_boxCenterUniform, (min + max) * 0.5f);
+    m_proxyShader->setVec3(m_boxSizeUniform, max - min);
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, query);
+    m_proxyCube->Draw(m_proxyShader->getAttributeMask());
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+}
+
+void OcclusionQueries::EndQueries()
+{
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    GLStateCache::DepthFunc(GL_LESS);
+    m_proxyShader = nullptr;
+    m_proxyCube = nullptr;
+}
+
+GLuint OcclusionQueries::allocateQuery()
+{
+    if (!m_freeQueries.empty()) {
+        GLuint query = m_freeQueries.back();
+        m_freeQueries.pop_back();
+        return query;
+    }
+    GLuint query;
+    glGenQueries(1, &query);
+    m_poolSize++;
+    return query;
+}
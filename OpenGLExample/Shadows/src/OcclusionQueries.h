@@ -0,0 +1,83 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Bounds.h"
+
+class Shader;
+class Primitive;
+
+/// <summary>
+/// Hardware occlusion queries on bounding box proxies. Each frame, after the opaque geometry is drawn,
+/// the boxes of queried objects are drawn with GL_ANY_SAMPLES_PASSED queries. Next frame, each object is drawn
+/// conditionally on its query (see Primitive::Draw), so the GPU skips it if its box was hidden, without the CPU waiting.
+/// Objects are identified by a key, e.g. their index, that must be stable between frames.
+/// Query objects are pooled and kept for RING_SIZE frames, after which results that have arrived are read
+/// back to count skipped draws.
+/// </summary>
+class OcclusionQueries {
+public:
+    //Frames a query stays in flight before it is recycled
+    static const unsigned int RING_SIZE = 3;
+
+    OcclusionQueries() = default;
+    OcclusionQueries(const OcclusionQueries&) = delete;
+    OcclusionQueries& operator=(const OcclusionQueries&) = delete;
+    ~OcclusionQueries();
+
+    //Recycles the queries issued RING_SIZE frames ago, reading their results if the GPU has them
+    void BeginFrame();
+    /// <summary>
+    /// Query issued for key last frame to draw key conditionally on, or 0 to draw unconditionally.
+    /// Marks the query as used, so its result counts towards skipped draws
+    /// </summary>
+    GLuint GetCondition(size_t key);
+
+    /// <summary>
+    /// Sets up proxy drawing: color and depth writes off, depth test GL_LEQUAL.
+    /// proxyCube must span -0.5 to 0.5 and proxyShader place it with u_boxCenter and u_boxSize
+    /// </summary>
+    void BeginQueries(Shader& proxyShader, Primitive& proxyCube, const glm::vec3& cameraPosition);
+    //Draws box inside a query for key. Skipped if the camera is inside box, since the object is then surely visible
+    void Query(size_t key, const AABB& box);
+    //Restores color and depth writes and GL_LESS
+    void EndQueries();
+
+    //Queries issued last frame
+    inline unsigned int GetIssuedCount() const { return m_lastIssued; }
+    //Conditional draws the GPU skipped, counted RING_SIZE - 1 frames late once their results arrive
+    inline unsigned int GetSkippedDraws() const { return m_skippedDraws; }
+    //Queries recycled before their result arrived
+    inline unsigned int GetPendingCount() const { return m_pendingResults; }
+    //Query objects created so far
+    inline size_t GetPoolSize() const { return m_poolSize; }
+private:
+    struct Entry {
+        GLuint query;
+        bool usedAsCondition;
+    };
+    struct Frame {
+        std::vector<Entry> entries;
+        //Index into entries per key, -1 if the key wasn't queried
+        std::vector<int> keyToEntry;
+    };
+
+    Frame m_frames[RING_SIZE];
+    unsigned int m_frame = 0;
+    std::vector<GLuint> m_freeQueries;
+    size_t m_poolSize = 0;
+    unsigned int m_lastIssued = 0;
+    unsigned int m_skippedDraws = 0;
+    unsigned int m_pendingResults = 0;
+
+    //Set between BeginQueries and EndQueries
+    Shader* m_proxyShader = nullptr;
+    int m_boxCenterUniform = -1;
+    int m_boxSizeUniform = -1;
+    Primitive* m_proxyCube = nullptr;
+    glm::vec3 m_cameraPosition = glm::vec3(0.0f);
+
+    GLuint allocateQuery();
+};
@@ -1,6 +1,8 @@
 #include "Primitive.h"
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <iostream>
+#include "GLStateCache.h"
 
 Primitive::Primitive(MeshData* meshData) : m_meshData(meshData)
 {
@@ -13,7 +15,7 @@ Primitive::Primitive(MeshData* meshData) : m_meshData(meshData)
     glGenBuffers(1, &m_ebo);
 
     //Bind Vertex Array Object
-    glBindVertexArray(m_vao);
+    GLStateCache::BindVertexArray(m_vao);
     //Bind Vertex Buffer Object to VAO
     glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
     //Fill VBO with vertex data
@@ -23,31 +25,133 @@ Primitive::Primitive(MeshData* meshData) : m_meshData(meshData)
     //Fill EBO with index data
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, meshData->indices.size() * sizeof(unsigned int), &meshData->indices[0], GL_STATIC_DRAW);
 
-    //Positions
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-    //Colors
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex,color)));
-    glEnableVertexAttribArray(1);
-    //Normal
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    glEnableVertexAttribArray(2);
-    //UV
-    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex,uv));
-    glEnableVertexAttribArray(3);
+    setupAttributes(VERTEX_ATTRIBUTE_ALL);
+    m_vaos[VERTEX_ATTRIBUTE_ALL] = m_vao;
 
     m_numIndices = meshData->indices.size();
+    computeBounds();
 }
 
 Primitive::~Primitive()
 {
-    glDeleteVertexArrays(1, &m_vao);
+    for (auto& entry : m_vaos)
+    {
+        GLStateCache::OnDeleteVertexArray(entry.second);
+        glDeleteVertexArrays(1, &entry.second);
+    }
     glDeleteBuffers(1, &m_vbo);
     glDeleteBuffers(1, &m_ebo);
 }
 
+void Primitive::computeBounds()
+{
+    if (m_meshData->vertices.empty()) {
+        m_bounds = { glm::vec3(0.0f), glm::vec3(0.0f) };
+        m_boundingSphere = { glm::vec3(0.0f), 0.0f };
+        return;
+    }
+
+    m_bounds = { m_meshData->vertices[0].position, m_meshData->vertices[0].position };
+    for (const Vertex& vertex : m_meshData->vertices)
+    {
+        m_bounds.min = glm::min(m_bounds.min, vertex.position);
+        m_bounds.max = glm::max(m_bounds.max, vertex.position);
+    }
+
+    //Centered on the box, which is tight enough for the convex shapes ShapeGen creates
+    m_boundingSphere.center = m_bounds.GetCenter();
+    float radiusSquared = 0.0f;
+    for (const Vertex& vertex : m_meshData->vertices)
+    {
+        glm::vec3 offset = vertex.position - m_boundingSphere.center;
+        radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+    }
+    m_boundingSphere.radius = std::sqrt(radiusSquared);
+}
+
 void Primitive::Draw()
 {
-    glBindVertexArray(m_vao);
+    GLStateCache::BindVertexArray(m_vao);
     glDrawElements(GL_TRIANGLES, (GLsizei)m_numIndices, GL_UNSIGNED_INT, 0);
 }
+
+void Primitive::Draw(unsigned int attributeMask)
+{
+    GLStateCache::BindVertexArray(getVAO(attributeMask));
+    glDrawElements(GL_TRIANGLES, (GLsizei)m_numIndices, GL_UNSIGNED_INT, 0);
+}
+
+void Primitive::Draw(unsigned int attributeMask, unsigned int conditionQuery)
+{
+    if (conditionQuery == 0) {
+        Draw(attributeMask);
+        return;
+    }
+    //Draws anyway if the result hasn't arrived, rather than stall
+    glBeginConditionalRender(conditionQuery, GL_QUERY_NO_WAIT);
+    Draw(attributeMask);
+    glEndConditionalRender();
+}
+
+bool Primitive::ValidateAttributes(const std::vector<ShaderAttribute>& attributes)
+{
+    //Expected type at each location of the Vertex layout
+    const GLenum vertexTypes[] = { GL_FLOAT_VEC3, GL_FLOAT_VEC3, GL_FLOAT_VEC3, GL_FLOAT_VEC2 };
+    const int numVertexTypes = sizeof(vertexTypes) / sizeof(vertexTypes[0]);
+
+    bool valid = true;
+    for (const ShaderAttribute& attribute : attributes)
+    {
+        if (attribute.location >= numVertexTypes) {
+            std::cout << "ERROR::PRIMITIVE::ATTRIBUTE_NOT_IN_VERTEX_LAYOUT " << attribute.name << " (location " << attribute.location << ")" << std::endl;
+            valid = false;
+        }
+        else if (attribute.type != vertexTypes[attribute.location]) {
+            std::cout << "ERROR::PRIMITIVE::ATTRIBUTE_TYPE_MISMATCH " << attribute.name << " (location " << attribute.location << ")" << std::endl;
+            valid = false;
+        }
+    }
+    return valid;
+}
+
+unsigned int Primitive::getVAO(unsigned int attributeMask)
+{
+    attributeMask &= VERTEX_ATTRIBUTE_ALL;
+    auto it = m_vaos.find(attributeMask);
+    if (it != m_vaos.end())
+        return it->second;
+
+    //New layout: share the existing buffers
+    unsigned int vao;
+    glGenVertexArrays(1, &vao);
+    GLStateCache::BindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    setupAttributes(attributeMask);
+    m_vaos[attributeMask] = vao;
+    return vao;
+}
+
+void Primitive::setupAttributes(unsigned int attributeMask)
+{
+    //Positions
+    if (attributeMask & (1u << VERTEX_ATTRIBUTE_POSITION)) {
+        glVertexAttribPointer(VERTEX_ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(VERTEX_ATTRIBUTE_POSITION);
+    }
+    //Colors
+    if (attributeMask & (1u << VERTEX_ATTRIBUTE_COLOR)) {
+        glVertexAttribPointer(VERTEX_ATTRIBUTE_COLOR, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(offsetof(Vertex,color)));
+        glEnableVertexAttribArray(VERTEX_ATTRIBUTE_COLOR);
+    }
+    //Normal
+    if (attributeMask & (1u << VERTEX_ATTRIBUTE_NORMAL)) {
+        glVertexAttribPointer(VERTEX_ATTRIBUTE_NORMAL, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+        glEnableVertexAttribArray(VERTEX_ATTRIBUTE_NORMAL);
+    }
+    //UV
+    if (attributeMask & (1u << VERTEX_ATTRIBUTE_UV)) {
+        glVertexAttribPointer(VERTEX_ATTRIBUTE_UV, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex,uv));
+        glEnableVertexAttribArray(VERTEX_ATTRIBUTE_UV);
+    }
+}
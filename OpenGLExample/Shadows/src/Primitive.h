@@ -1,6 +1,9 @@
 #pragma once
 #include <vector>
+#include <unordered_map>
 #include <glm/glm.hpp>
+#include "ShaderReflection.h"
+#include "Bounds.h"
 
 struct Vertex {
     glm::vec3 position;
@@ -9,6 +12,13 @@ struct Vertex {
     glm::vec2 uv;
 };
 
+//Attribute locations of the Vertex layout
+const unsigned int VERTEX_ATTRIBUTE_POSITION = 0;
+const unsigned int VERTEX_ATTRIBUTE_COLOR = 1;
+const unsigned int VERTEX_ATTRIBUTE_NORMAL = 2;
+const unsigned int VERTEX_ATTRIBUTE_UV = 3;
+const unsigned int VERTEX_ATTRIBUTE_ALL = 0xF;
+
 struct MeshData {
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
@@ -19,10 +29,40 @@ public:
     Primitive(MeshData* meshData);
     ~Primitive();
     void Draw();
+    /// <summary>
+    /// Draws with only the attribute streams in attributeMask enabled (see Shader::getAttributeMask).
+    /// Each mask gets its own VAO sharing this primitive's buffers, created on first use.
+    /// </summary>
+    void Draw(unsigned int attributeMask);
+    /// <summary>
+    /// Draws only if conditionQuery, an occlusion query from an earlier frame, saw any samples.
+    /// The GPU decides, so the CPU never waits for the result. 0 draws unconditionally
+    /// </summary>
+    void Draw(unsigned int attributeMask, unsigned int conditionQuery);
+    /// <summary>
+    /// Checks that a program's vertex inputs exist in the Vertex layout with matching types.
+    /// Prints an error per mismatch and returns false if any were found
+    /// </summary>
+    static bool ValidateAttributes(const std::vector<ShaderAttribute>& attributes);
+    //Local space bounds of the mesh, computed once on creation
+    inline const AABB& GetBounds() const { return m_bounds; }
+    inline const BoundingSphere& GetBoundingSphere() const { return m_boundingSphere; }
+    inline size_t GetTriangleCount() const { return m_numIndices / 3; }
+    //CPU copy of the mesh, e.g. for software rasterization
+    inline const MeshData* GetMeshData() const { return m_meshData; }
 private:
     MeshData* m_meshData;
     unsigned int m_vao;
     unsigned int m_vbo;
     unsigned int m_ebo;
     size_t m_numIndices;
-};
\ No newline at end of file
+    AABB m_bounds;
+    BoundingSphere m_boundingSphere;
+    //VAOs keyed by enabled attribute mask. m_vao is the full layout
+    std::unordered_map<unsigned int, unsigned int> m_vaos;
+
+    unsigned int getVAO(unsigned int attributeMask);
+    //Sets up attribute pointers for the VAO currently bound
+    void setupAttributes(unsigned int attributeMask);
+    void computeBounds();
+};
@@ -0,0 +1,104 @@
+#include "ProgramCache.h"
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+//Cache files are written next to the shader sources
+static const char* const CACHE_DIRECTORY = "shaders/";
+static const char* const CACHE_EXTENSION = ".programbin";
+
+//64-bit FNV-1a
+static uint64_t hashString(const std::string& str, uint64_t hash = 14695981039346656037ull)
+{
+    for (unsigned char c : str) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static std::string getGLString(GLenum name)
+{
+    const GLubyte* str = glGetString(name);
+    return str ? std::string((const char*)str) : std::string();
+}
+
+bool ProgramCache::IsSupported()
+{
+    if (!GLEW_ARB_get_program_binary)
+        return false;
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    return numFormats > 0;
+}
+
+std::string ProgramCache::MakeKey(const std::string& vertexCode, const std::string& fragmentCode)
+{
+    uint64_t hash = hashString(vertexCode);
+    //Separator so moving text between stages changes the key
+    hash = hashString("\n--\n", hash);
+    hash = hashString(fragmentCode, hash);
+    hash = hashString(getGLString(GL_VENDOR), hash);
+    hash = hashString(getGLString(GL_RENDERER), hash);
+    hash = hashString(getGLString(GL_VERSION), hash);
+
+    char key[17];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+    return std::string(key);
+}
+
+bool ProgramCache::Load(unsigned int programId, const std::string& key)
+{
+    std::ifstream file(getPath(key), std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+
+    std::streamsize fileSize = file.tellg();
+    if (fileSize <= (std::streamsize)sizeof(GLenum))
+        return false;
+    file.seekg(0);
+
+    //File layout: binary format enum followed by the binary itself
+    GLenum format;
+    file.read((char*)&format, sizeof(GLenum));
+    std::vector<char> binary((size_t)fileSize - sizeof(GLenum));
+    file.read(binary.data(), binary.size());
+    if (!file)
+        return false;
+
+    glProgramBinary(programId, format, binary.data(), (GLsizei)binary.size());
+
+    //The driver may reject binaries it no longer understands
+    int success;
+    glGetProgramiv(programId, GL_LINK_STATUS, &success);
+    return success != 0;
+}
+
+void ProgramCache::Store(unsigned int programId, const std::string& key)
+{
+    GLint length = 0;
+    glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format;
+    glGetProgramBinary(programId, length, NULL, &format, binary.data());
+
+    std::ofstream file(getPath(key), std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "ERROR::PROGRAM_CACHE::FILE_NOT_SUCCESFULLY_WRITTEN" << std::endl;
+        return;
+    }
+    file.write((const char*)&format, sizeof(GLenum));
+    file.write(binary.data(), binary.size());
+}
+
+std::string ProgramCache::getPath(const std::string& key)
+{
+    return std::string(CACHE_DIRECTORY) + key + CACHE_EXTENSION;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+
+/// <summary>
+/// On-disk cache of linked program binaries (glGetProgramBinary/glProgramBinary).
+/// Entries are keyed by a hash of the shader sources and the driver's vendor, renderer and version strings,
+/// so a source edit or driver update results in a cache miss and a normal compile.
+/// </summary>
+class ProgramCache {
+public:
+    //True if the driver exposes at least one program binary format
+    static bool IsSupported();
+    //Builds the cache key for a set of shader sources
+    static std::string MakeKey(const std::string& vertexCode, const std::string& fragmentCode);
+    //Loads a cached binary into programId. Returns false if missing or rejected by the driver
+    static bool Load(unsigned int programId, const std::string& key);
+    //Writes the linked binary of programId to disk
+    static void Store(unsigned int programId, const std::string& key);
+private:
+    static std::string getPath(const std::string& key);
+};
@@ -0,0 +1,388 @@
+#include "RenderGraph.h"
+#include "GLStateCache.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+
+#include <iostream>
+#include <algorithm>
+
+bool RenderTextureDesc::operator==(const RenderTextureDesc& other) const
+{
+    return width == other.width && height == other.height && internalFormat == other.internalFormat
+        && format == other.format && type == other.type && filter == other.filter && wrap == other.wrap;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(Resource resource)
+{
+    m_graph->m_passes[m_pass].reads.push_back(resource);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::WriteColor(Resource resource)
+{
+    m_graph->m_passes[m_pass].color = resource;
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::WriteDepth(Resource resource)
+{
+    m_graph->m_passes[m_pass].depth = resource;
+    return *this;
+}
+
+RenderGraph::~RenderGraph()
+{
+    for (const auto& framebuffer : m_framebuffers)
+        glDeleteFramebuffers(1, &framebuffer.second);
+    for (const Texture& texture : m_textures)
+    {
+        GLStateCache::OnDeleteTexture(texture.texture);
+        glDeleteTextures(1, &texture.texture);
+    }
+}
+
+void RenderGraph::Reset()
+{
+    m_passes.clear();
+    m_resources.clear();
+    m_order.clear();
+    m_barriers.clear();
+    m_transientCount = 0;
+}
+
+RenderGraph::Resource RenderGraph::CreateTexture(const char* name, const RenderTextureDesc& desc)
+{
+    m_resources.push_back({ name, desc, false, 0, -1, -1, -1 });
+    return (Resource)m_resources.size() - 1;
+}
+
+RenderGraph::Resource RenderGraph::ImportBackbuffer(const char* name, int width, int height)
+{
+    RenderTextureDesc desc = { width, height, GL_NONE, GL_NONE, GL_NONE, GL_NONE, GL_NONE };
+    m_resources.push_back({ name, desc, true, 0, -1, -1, -1 });
+    return (Resource)m_resources.size() - 1;
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const char* name, std::function<void()> execute)
+{
+    PassNode pass = {};
+    pass.name = name;
+    pass.execute = std::move(execute);
+    pass.color = INVALID_RESOURCE;
+    pass.depth = INVALID_RESOURCE;
+    m_passes.push_back(pass);
+    return PassBuilder(this, (int)m_passes.size() - 1);
+}
+
+void RenderGraph::Compile()
+{
+    CPU_PROFILE_ZONE("RenderGraph::Compile");
+    cullPasses();
+    computeLifetimes();
+    assignTextures();
+    assignFramebuffers();
+    findBarriers();
+}
+
+void RenderGraph::Execute(GpuProfiler* profiler)
+{
+    CPU_PROFILE_ZONE("RenderGraph::Execute");
+    bool bound = false;
+    GLuint boundFramebuffer = 0;
+    int viewportWidth = -1, viewportHeight = -1;
+    for (int index : m_order)
+    {
+        PassNode& pass = m_passes[index];
+        //Consecutive passes drawing to the same target, e.g. the backbuffer, skip the rebind
+        if (!bound || pass.framebuffer != boundFramebuffer) {
+            glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+            boundFramebuffer = pass.framebuffer;
+            bound = true;
+        }
+        if (pass.width != viewportWidth || pass.height != viewportHeight) {
+            glViewport(0, 0, pass.width, pass.height);
+            viewportWidth = pass.width;
+            viewportHeight = pass.height;
+        }
+        if (profiler != nullptr)
+            profiler->BeginZone(pass.name.c_str());
+        pass.execute();
+        if (profiler != nullptr)
+            profiler->EndZone();
+    }
+}
+
+GLuint RenderGraph::GetTexture(Resource resource) const
+{
+    int texture = m_resources[resource].texture;
+    return texture < 0 ? 0 : m_textures[texture].texture;
+}
+
+std::string RenderGraph::GetOrderString() const
+{
+    std::string order;
+    for (int index : m_order)
+    {
+        if (!order.empty())
+            order += " -> ";
+        order += m_passes[index].name;
+    }
+    return order;
+}
+
+void RenderGraph::cullPasses()
+{
+    //A pass is needed while any of its writes is read, a resource while any pass reading it is needed
+    for (ResourceNode& resource : m_resources)
+        resource.refCount = 0;
+    for (PassNode& pass : m_passes)
+    {
+        pass.refCount = 0;
+        pass.hasSideEffects = false;
+        pass.culled = false;
+        for (Resource resource : { pass.color, pass.depth })
+        {
+            if (resource == INVALID_RESOURCE)
+                continue;
+            pass.refCount++;
+            if (m_resources[resource].imported)
+                pass.hasSideEffects = true;
+        }
+        for (Resource resource : pass.reads)
+        {
+            m_resources[resource].refCount++;
+            if (resource == pass.color || resource == pass.depth)
+                std::cout << "ERROR::RENDER_GRAPH::FEEDBACK_LOOP\n" << pass.name << " reads " << m_resources[resource].name
+                    << " while drawing into it" << std::endl;
+        }
+    }
+
+    std::vector<Resource> unused;
+    for (size_t i = 0; i < m_resources.size(); i++)
+    {
+        if (m_resources[i].refCount == 0 && !m_resources[i].imported)
+            unused.push_back((Resource)i);
+    }
+    //Passes without any write have no visible effect
+    for (PassNode& pass : m_passes)
+    {
+        if (pass.refCount == 0) {
+            pass.culled = true;
+            for (Resource resource : pass.reads)
+            {
+                if (--m_resources[resource].refCount == 0 && !m_resources[resource].imported)
+                    unused.push_back(resource);
+            }
+        }
+    }
+
+    while (!unused.empty())
+    {
+        Resource resource = unused.back();
+        unused.pop_back();
+        for (PassNode& pass : m_passes)
+        {
+            if (pass.culled || pass.hasSideEffects || (pass.color != resource && pass.depth != resource))
+                continue;
+            if (--pass.refCount > 0)
+                continue;
+            //Nothing reads what this pass draws, so what it reads isn't needed by it either
+            pass.culled = true;
+            for (Resource read : pass.reads)
+            {
+                if (--m_resources[read].refCount == 0 && !m_resources[read].imported)
+                    unused.push_back(read);
+            }
+        }
+    }
+
+    //Dependencies always point to earlier passes, so the order they were added in is valid
+    m_order.clear();
+    for (size_t i = 0; i < m_passes.size(); i++)
+    {
+        if (!m_passes[i].culled)
+            m_order.push_back((int)i);
+    }
+}
+
+void RenderGraph::computeLifetimes()
+{
+    for (ResourceNode& resource : m_resources)
+    {
+        resource.firstUse = -1;
+        resource.lastUse = -1;
+    }
+    for (size_t position = 0; position < m_order.size(); position++)
+    {
+        const PassNode& pass = m_passes[m_order[position]];
+        auto use = [this, position](Resource resource) {
+            if (resource == INVALID_RESOURCE)
+                return;
+            ResourceNode& node = m_resources[resource];
+            if (node.firstUse < 0)
+                node.firstUse = (int)position;
+            node.lastUse = (int)position;
+        };
+        use(pass.color);
+        use(pass.depth);
+        for (Resource resource : pass.reads)
+            use(resource);
+    }
+}
+
+void RenderGraph::assignTextures()
+{
+    //Transients in the order they come alive, so a texture freed by one can be taken by the next
+    std::vector<Resource> transients;
+    for (size_t i = 0; i < m_resources.size(); i++)
+    {
+        ResourceNode& resource = m_resources[i];
+        resource.texture = -1;
+        if (!resource.imported && resource.firstUse >= 0)
+            transients.push_back((Resource)i);
+    }
+    std::stable_sort(transients.begin(), transients.end(), [this](Resource a, Resource b) {
+        return m_resources[a].firstUse < m_resources[b].firstUse;
+    });
+    m_transientCount = transients.size();
+
+    for (Texture& texture : m_textures)
+        texture.busyUntil = -1;
+    std::vector<bool> used(m_textures.size(), false);
+    for (Resource index : transients)
+    {
+        ResourceNode& resource = m_resources[index];
+        int found = -1;
+        for (size_t i = 0; i < m_textures.size(); i++)
+        {
+            if (m_textures[i].busyUntil < resource.firstUse && m_textures[i].desc == resource.desc) {
+                found = (int)i;
+                break;
+            }
+        }
+        if (found < 0) {
+            m_textures.push_back({ resource.desc, createTexture(resource.desc), -1 });
+            used.push_back(false);
+            found = (int)m_textures.size() - 1;
+        }
+        m_textures[found].busyUntil = resource.lastUse;
+        used[found] = true;
+        resource.texture = found;
+    }
+
+    //Release textures no pass needed this frame, along with the framebuffers they are attached to
+    std::vector<int> remap(m_textures.size(), -1);
+    std::vector<Texture> kept;
+    for (size_t i = 0; i < m_textures.size(); i++)
+    {
+        if (used[i]) {
+            remap[i] = (int)kept.size();
+            kept.push_back(m_textures[i]);
+            continue;
+        }
+        GLuint texture = m_textures[i].texture;
+        for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();)
+        {
+            if (it->first.first == texture || it->first.second == texture) {
+                glDeleteFramebuffers(1, &it->second);
+                it = m_framebuffers.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        GLStateCache::OnDeleteTexture(texture);
+        glDeleteTextures(1, &texture);
+    }
+    m_textures.swap(kept);
+    for (ResourceNode& resource : m_resources)
+    {
+        if (resource.texture >= 0)
+            resource.texture = remap[resource.texture];
+    }
+}
+
+void RenderGraph::assignFramebuffers()
+{
+    for (int index : m_order)
+    {
+        PassNode& pass = m_passes[index];
+        pass.framebuffer = 0;
+        pass.width = 0;
+        pass.height = 0;
+        Resource target = pass.color != INVALID_RESOURCE ? pass.color : pass.depth;
+        const RenderTextureDesc& desc = m_resources[target].desc;
+        pass.width = desc.width;
+        pass.height = desc.height;
+        if (pass.hasSideEffects) {
+            //The backbuffer has its own depth buffer, so it can't be combined with graph textures
+            if ((pass.color != INVALID_RESOURCE && !m_resources[pass.color].imported)
+                || (pass.depth != INVALID_RESOURCE && !m_resources[pass.depth].imported))
+                std::cout << "ERROR::RENDER_GRAPH::MIXED_TARGETS\n" << pass.name << " draws into the backbuffer and a texture" << std::endl;
+            continue;
+        }
+        GLuint color = pass.color == INVALID_RESOURCE ? 0 : GetTexture(pass.color);
+        GLuint depth = pass.depth == INVALID_RESOURCE ? 0 : GetTexture(pass.depth);
+        pass.framebuffer = getFramebuffer(color, depth);
+    }
+}
+
+void RenderGraph::findBarriers()
+{
+    m_barriers.clear();
+    std::vector<int> lastWriter(m_resources.size(), -1);
+    for (int index : m_order)
+    {
+        const PassNode& pass = m_passes[index];
+        for (Resource resource : pass.reads)
+        {
+            if (lastWriter[resource] >= 0)
+                m_barriers.push_back({ resource, lastWriter[resource], index });
+        }
+        if (pass.color != INVALID_RESOURCE)
+            lastWriter[pass.color] = index;
+        if (pass.depth != INVALID_RESOURCE)
+            lastWriter[pass.depth] = index;
+    }
+}
+
+GLuint RenderGraph::getFramebuffer(GLuint color, GLuint depth)
+{
+    auto key = std::make_pair(color, depth);
+    auto it = m_framebuffers.find(key);
+    if (it != m_framebuffers.end())
+        return it->second;
+
+    GLuint framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    if (color != 0) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    }
+    else {
+        //Depth only
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    if (depth != 0)
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::RENDER_GRAPH::FRAMEBUFFER_INCOMPLETE" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_framebuffers[key] = framebuffer;
+    return framebuffer;
+}
+
+GLuint RenderGraph::createTexture(const RenderTextureDesc& desc)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0, desc.format, desc.type, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, desc.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, desc.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, desc.wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, desc.wrap);
+    return texture;
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+class GpuProfiler;
+
+//Size and format of a texture the render graph creates
+struct RenderTextureDesc {
+    int width;
+    int height;
+    GLenum internalFormat;
+    GLenum format;
+    GLenum type;
+    GLenum filter;
+    GLenum wrap;
+
+    bool operator==(const RenderTextureDesc& other) const;
+};
+
+/// <summary>
+/// Frame described as passes that declare which textures they read and write. Rebuilt every frame:
+/// Reset, create or import resources, add passes in the order they should run, then Compile and Execute.
+/// Compile culls passes whose outputs nothing reads, lets transient textures whose lifetimes don't overlap share
+/// one GL texture, and records where a pass depends on an earlier one. Execute binds each pass's framebuffer
+/// and viewport before calling it.
+/// GL textures and framebuffers are kept between frames and released once no pass uses them.
+/// </summary>
+class RenderGraph {
+public:
+    typedef int Resource;
+    static const Resource INVALID_RESOURCE = -1;
+
+    //Declares what a pass touches, see AddPass
+    class PassBuilder {
+    public:
+        //Sampled by the pass
+        PassBuilder& Read(Resource resource);
+        //Drawn into as color attachment 0
+        PassBuilder& WriteColor(Resource resource);
+        PassBuilder& WriteDepth(Resource resource);
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph* graph, int pass) : m_graph(graph), m_pass(pass) {}
+        RenderGraph* m_graph;
+        int m_pass;
+    };
+
+    /// <summary>
+    /// Pass toPass reads what fromPass wrote. GL orders these by itself as long as a texture is never sampled
+    /// while attached to the bound framebuffer, which giving every pass its own framebuffer ensures.
+    /// Kept to inspect the compiled frame
+    /// </summary>
+    struct Barrier {
+        Resource resource;
+        int fromPass;
+        int toPass;
+    };
+
+    RenderGraph() = default;
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+    ~RenderGraph();
+
+    //Drops last frame's passes and resources. Their GL textures stay allocated for reuse
+    void Reset();
+    //Texture that only lives from the first to the last pass using it. Contents are undefined before the first write
+    Resource CreateTexture(const char* name, const RenderTextureDesc& desc);
+    //The window's framebuffer. Passes writing it are never culled
+    Resource ImportBackbuffer(const char* name, int width, int height);
+    //execute is called with the pass's framebuffer bound. Declare its resources on the returned builder
+    PassBuilder AddPass(const char* name, std::function<void()> execute);
+
+    //Culls passes, assigns GL textures and framebuffers and finds the barriers
+    void Compile();
+    //Runs the passes Compile kept, in the order they were added. Each pass is timed as a zone named after it if profiler is set
+    void Execute(GpuProfiler* profiler = nullptr);
+
+    //GL texture behind a transient resource after Compile. 0 if every pass using it was culled
+    GLuint GetTexture(Resource resource) const;
+
+    inline size_t GetPassCount() const { return m_passes.size(); }
+    inline size_t GetCulledCount() const { return m_passes.size() - m_order.size(); }
+    //Transient resources used by at least one pass this frame
+    inline size_t GetTransientCount() const { return m_transientCount; }
+    //GL textures backing them. Lower than GetTransientCount when textures are shared
+    inline size_t GetTextureCount() const { return m_textures.size(); }
+    inline const std::vector<Barrier>& GetBarriers() const { return m_barriers; }
+    //Names of the passes that run, in order, e.g. "Shadow -> Lit"
+    std::string GetOrderString() const;
+private:
+    struct ResourceNode {
+        std::string name;
+        RenderTextureDesc desc;
+        bool imported;
+        //Passes still needing it while culling
+        int refCount;
+        //Index into m_textures, -1 for imported resources and culled transients
+        int texture;
+        //Positions in m_order of the first and last pass using it
+        int firstUse;
+        int lastUse;
+    };
+    struct PassNode {
+        std::string name;
+        std::function<void()> execute;
+        std::vector<Resource> reads;
+        Resource color;
+        Resource depth;
+        //Writes still needed by someone while culling
+        int refCount;
+        //Writes an imported resource, so it is never culled
+        bool hasSideEffects;
+        bool culled;
+        GLuint framebuffer;
+        int width;
+        int height;
+    };
+    struct Texture {
+        RenderTextureDesc desc;
+        GLuint texture;
+        //Last pass position it is used at this frame, -1 if free so far
+        int busyUntil;
+    };
+
+    std::vector<PassNode> m_passes;
+    std::vector<ResourceNode> m_resources;
+    //Indices of the passes that run
+    std::vector<int> m_order;
+    std::vector<Barrier> m_barriers;
+    std::vector<Texture> m_textures;
+    //Framebuffers by color and depth texture
+    std::map<std::pair<GLuint, GLuint>, GLuint> m_framebuffers;
+    size_t m_transientCount = 0;
+
+    void cullPasses();
+    void computeLifetimes();
+    void assignTextures();
+    void assignFramebuffers();
+    void findBarriers();
+    GLuint getFramebuffer(GLuint color, GLuint depth);
+    static GLuint createTexture(const RenderTextureDesc& desc);
+};
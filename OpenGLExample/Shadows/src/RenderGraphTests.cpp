@@ -0,0 +1,126 @@
+#include "RenderGraphTests.h"
+#include "RenderGraph.h"
+
+#include <iostream>
+#include <string>
+
+namespace {
+
+const RenderTextureDesc COLOR_DESC = { 64, 64, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR, GL_CLAMP_TO_EDGE };
+const RenderTextureDesc SMALL_COLOR_DESC = { 32, 32, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR, GL_CLAMP_TO_EDGE };
+
+int s_failed = 0;
+int s_checks = 0;
+
+void check(bool passed, const char* test, const char* what)
+{
+    s_checks++;
+    if (passed)
+        return;
+    std::cout << "  FAILED " << test << ": " << what << std::endl;
+    s_failed++;
+}
+
+//Two transients of the same size, the second only created after the first was last read, share one texture
+void testAliasing()
+{
+    const char* name = "aliasing";
+    RenderGraph graph;
+    std::string order;
+    GLuint firstFrameTexture = 0;
+    for (int frame = 0; frame < 2; frame++)
+    {
+        graph.Reset();
+        order.clear();
+        RenderGraph::Resource backbuffer = graph.ImportBackbuffer("Backbuffer", 64, 64);
+        RenderGraph::Resource first = graph.CreateTexture("First", COLOR_DESC);
+        RenderGraph::Resource second = graph.CreateTexture("Second", COLOR_DESC);
+        graph.AddPass("WriteFirst", [&order]() { order += "1"; }).WriteColor(first);
+        graph.AddPass("ReadFirst", [&order]() { order += "2"; }).Read(first).WriteColor(backbuffer);
+        graph.AddPass("WriteSecond", [&order]() { order += "3"; }).WriteColor(second);
+        graph.AddPass("ReadSecond", [&order]() { order += "4"; }).Read(second).WriteColor(backbuffer);
+        graph.Compile();
+        if (frame == 0)
+            firstFrameTexture = graph.GetTexture(first);
+
+        check(graph.GetTransientCount() == 2, name, "expected 2 transient textures");
+        check(graph.GetTextureCount() == 1, name, "expected 1 allocation for both transients");
+        check(graph.GetTexture(first) != 0 && graph.GetTexture(first) == graph.GetTexture(second), name,
+            "transients don't share a texture");
+        check(graph.GetBarriers().size() == 2, name, "expected a barrier from each writer to its reader");
+        if (frame == 1)
+            check(graph.GetTexture(first) == firstFrameTexture, name, "texture not kept for the next frame");
+
+        graph.Execute();
+        check(order == "1234", name, "passes didn't run in the order they were added");
+    }
+}
+
+//A transient still needed when the next one is written can't be shared
+void testOverlap()
+{
+    const char* name = "overlapping lifetimes";
+    RenderGraph graph;
+    RenderGraph::Resource backbuffer = graph.ImportBackbuffer("Backbuffer", 64, 64);
+    RenderGraph::Resource first = graph.CreateTexture("First", COLOR_DESC);
+    RenderGraph::Resource second = graph.CreateTexture("Second", COLOR_DESC);
+    graph.AddPass("WriteFirst", []() {}).WriteColor(first);
+    graph.AddPass("WriteSecond", []() {}).WriteColor(second);
+    graph.AddPass("ReadBoth", []() {}).Read(first).Read(second).WriteColor(backbuffer);
+    graph.Compile();
+
+    check(graph.GetTextureCount() == 2, name, "expected 2 allocations");
+    check(graph.GetTexture(first) != graph.GetTexture(second), name, "live transients share a texture");
+}
+
+//Only textures of the same size and format are shared
+void testDifferentDesc()
+{
+    const char* name = "different sizes";
+    RenderGraph graph;
+    RenderGraph::Resource backbuffer = graph.ImportBackbuffer("Backbuffer", 64, 64);
+    RenderGraph::Resource first = graph.CreateTexture("First", COLOR_DESC);
+    RenderGraph::Resource second = graph.CreateTexture("Second", SMALL_COLOR_DESC);
+    graph.AddPass("WriteFirst", []() {}).WriteColor(first);
+    graph.AddPass("ReadFirst", []() {}).Read(first).WriteColor(backbuffer);
+    graph.AddPass("WriteSecond", []() {}).WriteColor(second);
+    graph.AddPass("ReadSecond", []() {}).Read(second).WriteColor(backbuffer);
+    graph.Compile();
+
+    check(graph.GetTextureCount() == 2, name, "expected 2 allocations");
+}
+
+//A pass whose output nothing reads is culled, runs nothing and gets no texture
+void testCulling()
+{
+    const char* name = "culling";
+    RenderGraph graph;
+    bool unusedRan = false, presentRan = false;
+    RenderGraph::Resource backbuffer = graph.ImportBackbuffer("Backbuffer", 64, 64);
+    RenderGraph::Resource unused = graph.CreateTexture("Unused", COLOR_DESC);
+    graph.AddPass("WriteUnused", [&unusedRan]() { unusedRan = true; }).WriteColor(unused);
+    graph.AddPass("Present", [&presentRan]() { presentRan = true; }).WriteColor(backbuffer);
+    graph.Compile();
+    graph.Execute();
+
+    check(graph.GetCulledCount() == 1, name, "expected 1 culled pass");
+    check(!unusedRan, name, "culled pass ran");
+    check(presentRan, name, "pass writing the backbuffer didn't run");
+    check(graph.GetTexture(unused) == 0 && graph.GetTextureCount() == 0, name, "culled pass's texture was allocated");
+}
+
+}
+
+int RunRenderGraphTests()
+{
+    s_failed = 0;
+    s_checks = 0;
+    testAliasing();
+    testOverlap();
+    testDifferentDesc();
+    testCulling();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    std::cout << "RenderGraph: " << s_checks - s_failed << " of " << s_checks << " checks passed" << std::endl;
+    return s_failed;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+/// <summary>
+/// Checks RenderGraph pass culling, transient texture aliasing and texture reuse across frames on small graphs,
+/// and prints each failing check. Needs a current GL context. Run with the --test-render-graph command line argument.
+/// Returns the number of failed checks.
+/// </summary>
+int RunRenderGraphTests();
@@ -0,0 +1,190 @@
+#include "RenderQueue.h"
+#include "Shader.h"
+#include "Primitive.h"
+#include "Material.h"
+#include "GLStateCache.h"
+#include "CommandList.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+//Key field widths and offsets, see RenderQueue.h
+const unsigned int PASS_BITS = 4;
+const unsigned int PROGRAM_BITS = 10;
+const unsigned int MATERIAL_BITS = 12;
+const unsigned int MESH_BITS = 12;
+const unsigned int DEPTH_BITS = 24;
+
+const unsigned int PASS_SHIFT = 60;
+const unsigned int TRANSPARENT_SHIFT = 59;
+//Opaque: state first, depth last
+const unsigned int OPAQUE_PROGRAM_SHIFT = 48;
+const unsigned int OPAQUE_MATERIAL_SHIFT = 36;
+const unsigned int OPAQUE_MESH_SHIFT = 24;
+const unsigned int OPAQUE_DEPTH_SHIFT = 0;
+//Transparent: depth first, state last
+const unsigned int TRANSPARENT_DEPTH_SHIFT = 35;
+const unsigned int TRANSPARENT_PROGRAM_SHIFT = 25;
+const unsigned int TRANSPARENT_MATERIAL_SHIFT = 13;
+const unsigned int TRANSPARENT_MESH_SHIFT = 1;
+
+void RenderQueue::Clear()
+{
+    m_commands.clear();
+    m_order.clear();
+    m_unsortedStateChanges = 0;
+    m_sortedStateChanges = 0;
+}
+
+void RenderQueue::Submit(unsigned int pass, Shader* shader, Primitive* primitive, Material* material, size_t objectIndex, float depth, bool transparent)
+{
+    uint64_t program = getId(m_programIds, (uintptr_t)shader, PROGRAM_BITS);
+    uint64_t materialId = getId(m_materialIds, (uintptr_t)material, MATERIAL_BITS);
+    uint64_t mesh = getId(m_meshIds, (uintptr_t)primitive, MESH_BITS);
+    uint64_t quantizedDepth = quantizeDepth(depth);
+
+    uint64_t key = (uint64_t)(pass & ((1u << PASS_BITS) - 1)) << PASS_SHIFT;
+    if (transparent) {
+        //Far to near
+        uint64_t invertedDepth = ((1u << DEPTH_BITS) - 1) - quantizedDepth;
+        key |= 1ull << TRANSPARENT_SHIFT;
+        key |= invertedDepth << TRANSPARENT_DEPTH_SHIFT;
+        key |= program << TRANSPARENT_PROGRAM_SHIFT;
+        key |= materialId << TRANSPARENT_MATERIAL_SHIFT;
+        key |= mesh << TRANSPARENT_MESH_SHIFT;
+    }
+    else {
+        key |= program << OPAQUE_PROGRAM_SHIFT;
+        key |= materialId << OPAQUE_MATERIAL_SHIFT;
+        key |= mesh << OPAQUE_MESH_SHIFT;
+        key |= quantizedDepth << OPAQUE_DEPTH_SHIFT;
+    }
+
+    m_commands.push_back({ key, shader, primitive, material, objectIndex, transparent });
+}
+
+void RenderQueue::Submit(const CommandList& list)
+{
+    for (const DrawPacket& packet : list.GetPackets())
+        Submit(packet.pass, packet.shader, packet.primitive, packet.material, packet.objectIndex, packet.depth, packet.transparent);
+}
+
+void RenderQueue::Sort()
+{
+    CPU_PROFILE_ZONE("RenderQueue::Sort");
+    size_t count = m_commands.size();
+    m_order.resize(count);
+    m_scratch.resize(count);
+    for (size_t i = 0; i < count; i++)
+        m_order[i] = (uint32_t)i;
+    m_unsortedStateChanges = countStateChanges(m_order);
+
+    //LSD radix sort, 8 bits per pass. All histograms are built in a single read of the keys
+    const unsigned int RADIX_PASSES = 8;
+    uint32_t histograms[RADIX_PASSES][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (const RenderCommand& command : m_commands) {
+        for (unsigned int pass = 0; pass < RADIX_PASSES; pass++)
+            histograms[pass][(command.key >> (pass * 8)) & 0xFF]++;
+    }
+
+    for (unsigned int pass = 0; pass < RADIX_PASSES; pass++)
+    {
+        uint32_t* histogram = histograms[pass];
+        //Every key has the same byte here, so this pass wouldn't move anything
+        if (count == 0 || histogram[(m_commands[0].key >> (pass * 8)) & 0xFF] == count)
+            continue;
+
+        uint32_t offsets[256];
+        uint32_t sum = 0;
+        for (unsigned int i = 0; i < 256; i++) {
+            offsets[i] = sum;
+            sum += histogram[i];
+        }
+        for (uint32_t index : m_order)
+            m_scratch[offsets[(m_commands[index].key >> (pass * 8)) & 0xFF]++] = index;
+        m_order.swap(m_scratch);
+    }
+
+    m_sortedStateChanges = countStateChanges(m_order);
+}
+
+void RenderQueue::Execute(unsigned int pass, const std::function<void(const RenderCommand&)>& draw)
+{
+    //Commands of a pass are contiguous since the pass is the top of the key
+    uint64_t passKey = (uint64_t)pass << PASS_SHIFT;
+    auto begin = std::lower_bound(m_order.begin(), m_order.end(), passKey,
+        [this](uint32_t index, uint64_t key) { return m_commands[index].key < key; });
+
+    Shader* currentShader = nullptr;
+    Material* currentMaterial = nullptr;
+    bool blending = false;
+    for (auto it = begin; it != m_order.end(); ++it)
+    {
+        const RenderCommand& command = m_commands[*it];
+        if ((command.key >> PASS_SHIFT) != pass)
+            break;
+
+        if (command.transparent && !blending) {
+            //Transparent draws are blended over the opaque ones and don't hide each other
+            GLStateCache::Enable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            blending = true;
+        }
+        if (command.shader != currentShader) {
+            command.shader->use();
+            currentShader = command.shader;
+        }
+        if (command.material != currentMaterial && command.material != nullptr) {
+            command.material->Bind();
+            currentMaterial = command.material;
+        }
+        draw(command);
+    }
+
+    if (blending) {
+        GLStateCache::Disable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+    }
+}
+
+uint32_t RenderQueue::getId(std::unordered_map<uintptr_t, uint32_t>& ids, uintptr_t object, unsigned int bits)
+{
+    auto it = ids.find(object);
+    if (it != ids.end())
+        return it->second;
+    //Ids wrap once a field is full. Sorting then only groups less well, draws stay correct
+    uint32_t id = (uint32_t)ids.size() & ((1u << bits) - 1);
+    ids[object] = id;
+    return id;
+}
+
+uint32_t RenderQueue::quantizeDepth(float depth)
+{
+    //Bits of a non-negative float sort like the float itself. Keep the exponent and the top of the mantissa
+    uint32_t bits;
+    depth = std::max(depth, 0.0f);
+    memcpy(&bits, &depth, sizeof(bits));
+    return bits >> (32 - DEPTH_BITS - 1);
+}
+
+unsigned int RenderQueue::countStateChanges(const std::vector<uint32_t>& order) const
+{
+    unsigned int changes = 0;
+    const RenderCommand* previous = nullptr;
+    for (uint32_t index : order)
+    {
+        const RenderCommand& command = m_commands[index];
+        bool newPass = previous == nullptr || (previous->key >> PASS_SHIFT) != (command.key >> PASS_SHIFT);
+        if (newPass || previous->shader != command.shader)
+            changes++;
+        if (newPass || previous->material != command.material)
+            changes++;
+        if (newPass || previous->primitive != command.primitive)
+            changes++;
+        previous = &command;
+    }
+    return changes;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class Shader;
+class Primitive;
+class Material;
+class CommandList;
+
+/// <summary>
+/// One draw submitted to a RenderQueue
+/// </summary>
+struct RenderCommand {
+    uint64_t key;
+    Shader* shader;
+    Primitive* primitive;
+    //Null for passes that don't shade, e.g. depth only
+    Material* material;
+    //Entry in the per-object uniform buffer
+    size_t objectIndex;
+    bool transparent;
+};
+
+/// <summary>
+/// Collects draws for a frame and orders them by a 64-bit sort key so state changes are minimized.
+/// Opaque key, most significant first: pass (4) | transparent = 0 (1) | program (10) | material (12) | mesh (12) | depth (24).
+/// Transparent draws swap depth in front of the state fields and invert it, so they are drawn back to front
+/// after all opaque draws of the same pass. Opaque draws of the same state are drawn front to back.
+/// </summary>
+class RenderQueue {
+public:
+    static const unsigned int MAX_PASSES = 16;
+
+    //Drops last frame's commands. Ids assigned to programs, materials and meshes are kept
+    void Clear();
+    /// <summary>
+    /// Adds a draw to pass. depth is the distance from the pass's viewpoint and must not be negative
+    /// </summary>
+    void Submit(unsigned int pass, Shader* shader, Primitive* primitive, Material* material, size_t objectIndex, float depth, bool transparent = false);
+    /// <summary>
+    /// Adds every packet recorded in list. Ids and keys are assigned here, so lists can be recorded on other threads
+    /// </summary>
+    void Submit(const CommandList& list);
+    /// <summary>
+    /// Radix sorts all commands by key. Must be called after the last Submit and before Execute
+    /// </summary>
+    void Sort();
+    /// <summary>
+    /// Binds each command's program and material when they change and hands the command to draw, in sorted order.
+    /// Blending is enabled for transparent commands and disabled again afterwards
+    /// </summary>
+    void Execute(unsigned int pass, const std::function<void(const RenderCommand&)>& draw);
+
+    inline size_t GetCommandCount() const { return m_commands.size(); }
+    //Program, material and mesh changes if the commands were drawn in submission order
+    inline unsigned int GetUnsortedStateChanges() const { return m_unsortedStateChanges; }
+    //Program, material and mesh changes in sorted order
+    inline unsigned int GetSortedStateChanges() const { return m_sortedStateChanges; }
+private:
+    std::vector<RenderCommand> m_commands;
+    //Sorted order as indices into m_commands, plus scratch space for the radix sort
+    std::vector<uint32_t> m_order;
+    std::vector<uint32_t> m_scratch;
+    std::unordered_map<uintptr_t, uint32_t> m_programIds;
+    std::unordered_map<uintptr_t, uint32_t> m_materialIds;
+    std::unordered_map<uintptr_t, uint32_t> m_meshIds;
+    unsigned int m_unsortedStateChanges = 0;
+    unsigned int m_sortedStateChanges = 0;
+
+    static uint32_t getId(std::unordered_map<uintptr_t, uint32_t>& ids, uintptr_t object, unsigned int bits);
+    static uint32_t quantizeDepth(float depth);
+    //Counts program, material and mesh changes between consecutive commands of the same pass
+    unsigned int countStateChanges(const std::vector<uint32_t>& order) const;
+};
@@ -1,117 +1,351 @@
 #include "Shader.h"
+#include "ProgramCache.h"
+#include "GLStateCache.h"
+#include "ShaderSource.h"
+#include "CpuProfiler.h"
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+#include <thread>
+#include <cstring>
+
+unsigned long long Shader::s_totalUniformHits = 0;
+unsigned long long Shader::s_totalUniformMisses = 0;
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, bool deferCompile, const std::vector<std::string>& defines,
+    const std::vector<std::string>& undefines)
+    : m_vertexPath(vertexPath), m_fragmentPath(fragmentPath), m_defines(defines), m_undefines(undefines)
 {
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    // ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try
+    if (deferCompile)
+        return;
+    submit();
+    finish();
+}
+
+void Shader::compileBatch(const std::vector<Shader*>& shaders)
+{
+    CPU_PROFILE_ZONE("Shader::compileBatch");
+    //Let the driver compile on as many threads as it likes
+    bool parallel = GLEW_KHR_parallel_shader_compile;
+    if (parallel)
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+
+    //Issue every compile and link before querying any status, so the driver never stalls between programs
+    for (Shader* shader : shaders)
+        shader->submit();
+
+    //Check status in completion order
+    std::vector<Shader*> pending = shaders;
+    while (!pending.empty())
     {
-        // open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        // read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        // close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
-        // convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        for (size_t i = 0; i < pending.size();)
+        {
+            if (pending[i]->isReady()) {
+                pending[i]->finish();
+                pending.erase(pending.begin() + i);
+            }
+            else {
+                i++;
+            }
+        }
+        if (!pending.empty())
+            std::this_thread::yield();
     }
-    catch (std::ifstream::failure e)
+}
+
+void Shader::submit()
+{
+    CPU_PROFILE_ZONE("Shader::submit");
+    m_submitTime = std::chrono::high_resolution_clock::now();
+
+    //Embedded sources with #includes already expanded
+    std::string vertexCode;
+    std::string fragmentCode;
+    if (!ShaderSource::Get(m_vertexPath, vertexCode) || !ShaderSource::Get(m_fragmentPath, fragmentCode))
     {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
     }
+    vertexCode = injectDefines(vertexCode);
+    fragmentCode = injectDefines(fragmentCode);
+    //Runs after defines are injected so only the code this variant compiles is considered
+    m_optimizerReport = ShaderOptimizer::Optimize(vertexCode, fragmentCode, m_undefines);
+
+    m_id = glCreateProgram();
+
+    //Try the program binary cache before compiling from source
+    m_useCache = ProgramCache::IsSupported();
+    if (m_useCache) {
+        m_cacheKey = ProgramCache::MakeKey(vertexCode, fragmentCode);
+        m_loadedFromCache = ProgramCache::Load(m_id, m_cacheKey);
+    }
+    if (m_loadedFromCache)
+        return;
+
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
 
-    //Compile Shaders
-    unsigned int vertexShaderId, fragmentShaderId;
-    int success;
-    char infoLog[512];
-
-    //Vertex Shader
-    vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShaderId, 1, &vShaderCode, NULL);
-    glCompileShader(vertexShaderId);
-    // print compile errors if any
-    glGetShaderiv(vertexShaderId, GL_COMPILE_STATUS, &success);
-    if (!success)
+    //Compile Shaders. Status is checked in finish()
+    m_vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(m_vertexShaderId, 1, &vShaderCode, NULL);
+    glCompileShader(m_vertexShaderId);
+
+    m_fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(m_fragmentShaderId, 1, &fShaderCode, NULL);
+    glCompileShader(m_fragmentShaderId);
+
+    //Link Shader Program
+    //Ask the driver to keep the binary around for ProgramCache
+    if (GLEW_ARB_get_program_binary)
+        glProgramParameteri(m_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(m_id, m_vertexShaderId);
+    glAttachShader(m_id, m_fragmentShaderId);
+    glLinkProgram(m_id);
+}
+
+bool Shader::isReady() const
+{
+    //Without the extension, status queries simply block until the driver is done
+    if (m_loadedFromCache || !GLEW_KHR_parallel_shader_compile)
+        return true;
+    int complete;
+    glGetProgramiv(m_id, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete != 0;
+}
+
+void Shader::finish()
+{
+    CPU_PROFILE_ZONE("Shader::finish");
+    bool linked = m_loadedFromCache;
+    if (!m_loadedFromCache)
+    {
+        int success;
+        char infoLog[512];
+
+        // print compile errors if any
+        glGetShaderiv(m_vertexShaderId, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(m_vertexShaderId, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        };
+        glGetShaderiv(m_fragmentShaderId, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(m_fragmentShaderId, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        };
+
+        // print linking errors if any
+        glGetProgramiv(m_id, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glGetProgramInfoLog(m_id, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        }
+        else if (m_useCache)
+        {
+            ProgramCache::Store(m_id, m_cacheKey);
+        }
+        linked = success != 0;
+
+        // delete the shaders as they're linked into our program now and no longer necessary
+        glDeleteShader(m_vertexShaderId);
+        glDeleteShader(m_fragmentShaderId);
+        m_vertexShaderId = m_fragmentShaderId = 0;
+    }
+
+    if (linked)
+        reflect();
+
+    std::chrono::duration<float, std::milli> elapsed = std::chrono::high_resolution_clock::now() - m_submitTime;
+    m_loadTimeMs = elapsed.count();
+    std::cout << (m_loadedFromCache ? "Loaded cached program " : "Compiled program ")
+        << m_vertexPath << " + " << m_fragmentPath;
+    for (const std::string& define : m_defines)
+        std::cout << " " << define;
+    std::cout << " in " << m_loadTimeMs << " ms" << std::endl;
+
+    if (!m_optimizerReport.IsEmpty())
     {
-        glGetShaderInfoLog(vertexShaderId, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    };
-
-    //Fragment shader
-    fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShaderId, 1, &fShaderCode, NULL);
-    glCompileShader(fragmentShaderId);
-    // print compile errors if any
-    glGetShaderiv(fragmentShaderId, GL_COMPILE_STATUS, &success);
-    if (!success)
+        std::cout << (ShaderOptimizer::IsStripEnabled() ? "  stripped" : "  WARNING::SHADER::UNUSED_CODE");
+        if (!m_optimizerReport.unusedVaryings.empty()) {
+            std::cout << " unused varyings:";
+            for (const std::string& name : m_optimizerReport.unusedVaryings)
+                std::cout << " " << name;
+            std::cout << " (" << m_optimizerReport.varyingComponents << " components)";
+        }
+        if (!m_optimizerReport.deadVariables.empty()) {
+            std::cout << " dead variables:";
+            for (const std::string& name : m_optimizerReport.deadVariables)
+                std::cout << " " << name;
+        }
+        std::cout << ", " << m_optimizerReport.lines << " lines, " << m_optimizerReport.bytes << " bytes" << std::endl;
+    }
+}
+
+void Shader::reflect()
+{
+    char name[256];
+    GLsizei nameLength;
+    GLint size;
+    GLenum type;
+
+    //Vertex inputs
+    int numAttributes = 0;
+    glGetProgramiv(m_id, GL_ACTIVE_ATTRIBUTES, &numAttributes);
+    m_attributeMask = 0;
+    for (int i = 0; i < numAttributes; i++)
     {
-        glGetShaderInfoLog(fragmentShaderId, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    };
+        glGetActiveAttrib(m_id, i, sizeof(name), &nameLength, &size, &type, name);
+        ShaderAttribute attribute = { std::string(name, nameLength), type, glGetAttribLocation(m_id, name) };
+        //Built-ins like gl_VertexID have no location
+        if (attribute.location < 0)
+            continue;
+        m_attributes.push_back(attribute);
+        if (attribute.location < 32)
+            m_attributeMask |= 1u << attribute.location;
+    }
 
-    //Create Shader Program
-    m_id = glCreateProgram();
-    glAttachShader(m_id, vertexShaderId);
-    glAttachShader(m_id, fragmentShaderId);
-    glLinkProgram(m_id);
-    // print linking errors if any
-    glGetProgramiv(m_id, GL_LINK_STATUS, &success);
-    if (!success)
+    //Uniform blocks
+    int numBlocks = 0;
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+    for (int i = 0; i < numBlocks; i++)
     {
-        glGetProgramInfoLog(m_id, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        glGetActiveUniformBlockName(m_id, i, sizeof(name), &nameLength, name);
+        ShaderUniformBlock block = { std::string(name, nameLength), 0, 0 };
+        glGetActiveUniformBlockiv(m_id, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize);
+        GLint binding = 0;
+        glGetActiveUniformBlockiv(m_id, i, GL_UNIFORM_BLOCK_BINDING, &binding);
+        block.binding = (unsigned int)binding;
+        m_uniformBlocks.push_back(block);
     }
 
-    // delete the shaders as they're linked into our program now and no longer necessary
-    glDeleteShader(vertexShaderId);
-    glDeleteShader(fragmentShaderId);
+    //Uniforms. Default block locations are resolved here once so setters never ask the driver by name
+    int numUniforms = 0;
+    glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &numUniforms);
+    for (int i = 0; i < numUniforms; i++)
+    {
+        glGetActiveUniform(m_id, i, sizeof(name), &nameLength, &size, &type, name);
+        GLuint index = i;
+        GLint blockIndex = -1;
+        glGetActiveUniformsiv(m_id, 1, &index, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+        ShaderUniform uniform = { std::string(name, nameLength), type, -1, blockIndex };
+        if (blockIndex < 0) {
+            uniform.location = glGetUniformLocation(m_id, name);
+            CachedUniform& cached = m_uniformCache[getUniformHandle(uniform.name)];
+            cached.location = uniform.location;
+        }
+        m_uniforms.push_back(uniform);
+    }
+}
+
+std::string Shader::injectDefines(const std::string& code) const
+{
+    if (m_defines.empty())
+        return code;
+
+    std::string defineBlock;
+    for (const std::string& define : m_defines)
+        defineBlock += "#define " + define + "\n";
+
+    //#version must stay the first statement, so defines go on the line after it
+    size_t insertPos = 0;
+    size_t versionPos = code.find("#version");
+    if (versionPos != std::string::npos) {
+        size_t lineEnd = code.find('\n', versionPos);
+        insertPos = (lineEnd == std::string::npos) ? code.size() : lineEnd + 1;
+    }
+    std::string result = code;
+    if (insertPos == result.size() && (result.empty() || result.back() != '\n'))
+        defineBlock = "\n" + defineBlock;
+    result.insert(insertPos, defineBlock);
+    return result;
 }
 
 void Shader::use() {
-    glUseProgram(m_id);
+    GLStateCache::UseProgram(m_id);
 }
 
-void Shader::setBool(const std::string& name, bool value) const
+int Shader::getUniformHandle(const std::string& name) const
 {
-    glUniform1i(getUniformLocation(name), (int)value);
+    auto it = m_uniformHandles.find(name);
+    if (it != m_uniformHandles.end())
+        return it->second;
+    CachedUniform cached = {};
+    //Active uniforms were added by reflect(). Others are e.g. later array elements, or unused
+    cached.location = glGetUniformLocation(m_id, name.c_str());
+    m_uniformCache.push_back(cached);
+    int handle = (int)m_uniformCache.size() - 1;
+    m_uniformHandles[name] = handle;
+    return handle;
 }
 
-void Shader::setInt(const std::string& name, int value) const
+void Shader::setBool(int handle, bool value) const
 {
-    glUniform1i(getUniformLocation(name), value);
+    int intValue = (int)value;
+    int location;
+    if (isUniformDirty(handle, &intValue, sizeof(int), location))
+        glUniform1i(location, intValue);
 }
 
-void Shader::setFloat(const std::string& name, float value) const 
+void Shader::setInt(int handle, int value) const
 {
-    glUniform1f(getUniformLocation(name), value);
+    int location;
+    if (isUniformDirty(handle, &value, sizeof(int), location))
+        glUniform1i(location, value);
 }
-void Shader::setVec2(const std::string& name, const glm::vec2& value) const {
-    glUniform2f(getUniformLocation(name), value.x, value.y);
+
+void Shader::setFloat(int handle, float value) const
+{
+    int location;
+    if (isUniformDirty(handle, &value, sizeof(float), location))
+        glUniform1f(location, value);
+}
+void Shader::setVec2(int handle, const glm::vec2& value) const {
+    int location;
+    if (isUniformDirty(handle, &value, sizeof(glm::vec2), location))
+        glUniform2f(location, value.x, value.y);
 }
 
-void Shader::setVec3(const std::string& name, const glm::vec3& value) const
+void Shader::setVec3(int handle, const glm::vec3& value) const
 {
-    glUniform3f(getUniformLocation(name), value.x, value.y, value.z);
+    int location;
+    if (isUniformDirty(handle, &value, sizeof(glm::vec3), location))
+        glUniform3f(location, value.x, value.y, value.z);
 }
 
-void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
+void Shader::setMat4(int handle, const glm::mat4& mat) const
 {
-    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat));
+    int location;
+    if (isUniformDirty(handle, &mat, sizeof(glm::mat4), location))
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
 }
 
-unsigned int Shader::getUniformLocation(const std::string& name) const
+void Shader::bindUniformBlock(const std::string& blockName, unsigned int binding)
 {
-    return glGetUniformLocation(m_id, name.c_str());
+    unsigned int blockIndex = glGetUniformBlockIndex(m_id, blockName.c_str());
+    //Programs that don't declare the block are skipped
+    if (blockIndex == GL_INVALID_INDEX)
+        return;
+    glUniformBlockBinding(m_id, blockIndex, binding);
+    for (ShaderUniformBlock& block : m_uniformBlocks)
+    {
+        if (block.name == blockName)
+            block.binding = binding;
+    }
+}
+
+bool Shader::isUniformDirty(int handle, const void* value, size_t size, int& location) const
+{
+    CachedUniform& cached = m_uniformCache[handle];
+    location = cached.location;
+    if (cached.hasValue && cached.size == size && memcmp(cached.value, value, size) == 0) {
+        m_uniformHits++;
+        s_totalUniformHits++;
+        return false;
+    }
+    cached.hasValue = true;
+    cached.size = size;
+    memcpy(cached.value, value, size);
+    m_uniformMisses++;
+    s_totalUniformMisses++;
+    return true;
 }
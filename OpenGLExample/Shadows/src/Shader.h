@@ -8,6 +8,11 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+#include "ShaderReflection.h"
+#include "ShaderOptimizer.h"
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -15,20 +20,99 @@ class Shader
 {
 public:
     // constructor reads and builds the shader
-    Shader(const char* vertexPath, const char* fragmentPath);
+    // If deferCompile is set, nothing is built until the shader is passed to compileBatch
+    // defines are inserted as "#define <define>" lines after #version in both stages
+    // undefines are macros known to stay undefined, which lets ShaderOptimizer resolve #ifdef blocks using them
+    Shader(const char* vertexPath, const char* fragmentPath, bool deferCompile = false, const std::vector<std::string>& defines = {},
+        const std::vector<std::string>& undefines = {});
+    // Submits all compiles and links up front, then checks status as each program completes.
+    // Uses GL_KHR_parallel_shader_compile when available so the driver can compile on multiple threads
+    static void compileBatch(const std::vector<Shader*>& shaders);
     // use/activate the shader
     void use();
-    //Uniform setters
-    void setBool(const std::string& name, bool value) const;
-    void setInt(const std::string& name, int value) const;
-    void setFloat(const std::string& name, float value) const;
-    void setVec2(const std::string& name, const glm::vec2& value) const;
-    void setVec3(const std::string& name, const glm::vec3& value) const;
-    void setMat4(const std::string& name, const glm::mat4& mat) const;
+    //Resolves a uniform by name once the program is linked. Setters taking the handle skip the name lookup, so use them on hot paths.
+    //Names the program doesn't use still get a handle, and uploads to it are ignored like location -1
+    int getUniformHandle(const std::string& name) const;
+    //Uniform setters. Values are compared against a per-program shadow copy and unchanged values are not sent to the driver
+    void setBool(int handle, bool value) const;
+    void setInt(int handle, int value) const;
+    void setFloat(int handle, float value) const;
+    void setVec2(int handle, const glm::vec2& value) const;
+    void setVec3(int handle, const glm::vec3& value) const;
+    void setMat4(int handle, const glm::mat4& mat) const;
+    //Same, looking the name up on every call. Fine for setup code
+    void setBool(const std::string& name, bool value) const { setBool(getUniformHandle(name), value); }
+    void setInt(const std::string& name, int value) const { setInt(getUniformHandle(name), value); }
+    void setFloat(const std::string& name, float value) const { setFloat(getUniformHandle(name), value); }
+    void setVec2(const std::string& name, const glm::vec2& value) const { setVec2(getUniformHandle(name), value); }
+    void setVec3(const std::string& name, const glm::vec3& value) const { setVec3(getUniformHandle(name), value); }
+    void setMat4(const std::string& name, const glm::mat4& mat) const { setMat4(getUniformHandle(name), mat); }
+    //Connects a uniform block in this program to a uniform buffer binding point
+    void bindUniformBlock(const std::string& blockName, unsigned int binding);
+    //Latency from submission until the program was ready (compiled and linked, or loaded from cache)
+    inline float getLoadTime() const { return m_loadTimeMs; }
+    inline bool isLoadedFromCache() const { return m_loadedFromCache; }
+    //Unused varyings and dead variables found in the sources at load time
+    inline const ShaderOptimizerReport& getOptimizerReport() const { return m_optimizerReport; }
+    //Program interface, filled in after a successful link
+    inline const std::vector<ShaderAttribute>& getAttributes() const { return m_attributes; }
+    inline const std::vector<ShaderUniform>& getUniforms() const { return m_uniforms; }
+    inline const std::vector<ShaderUniformBlock>& getUniformBlocks() const { return m_uniformBlocks; }
+    //Bit n is set if the program reads the vertex attribute at location n
+    inline unsigned int getAttributeMask() const { return m_attributeMask; }
+    //Setter calls skipped because the value was unchanged (hits), and calls sent to the driver (misses)
+    inline unsigned long long getUniformHits() const { return m_uniformHits; }
+    inline unsigned long long getUniformMisses() const { return m_uniformMisses; }
+    //Totals across all programs
+    inline static unsigned long long getTotalUniformHits() { return s_totalUniformHits; }
+    inline static unsigned long long getTotalUniformMisses() { return s_totalUniformMisses; }
 private:
     //Program ID in openGL
-    unsigned int m_id;
-    unsigned int getUniformLocation(const std::string& name) const;
+    unsigned int m_id = 0;
+    std::string m_vertexPath;
+    std::string m_fragmentPath;
+    std::vector<std::string> m_defines;
+    std::vector<std::string> m_undefines;
+    //Stage objects kept alive between submit() and finish()
+    unsigned int m_vertexShaderId = 0;
+    unsigned int m_fragmentShaderId = 0;
+    std::string m_cacheKey;
+    bool m_useCache = false;
+    bool m_loadedFromCache = false;
+    std::chrono::high_resolution_clock::time_point m_submitTime;
+    float m_loadTimeMs = 0.0f;
+    std::vector<ShaderAttribute> m_attributes;
+    std::vector<ShaderUniform> m_uniforms;
+    std::vector<ShaderUniformBlock> m_uniformBlocks;
+    unsigned int m_attributeMask = 0;
+    ShaderOptimizerReport m_optimizerReport;
+    //Queries active attributes, uniforms and uniform blocks
+    void reflect();
+    //Inserts m_defines after the #version directive
+    std::string injectDefines(const std::string& code) const;
+    //Reads sources and starts compiling and linking without waiting on the driver
+    void submit();
+    //True once the driver has finished compiling and linking
+    bool isReady() const;
+    //Checks and reports compile/link status, then releases stage objects
+    void finish();
+    //Shadow copy of a uniform's last uploaded value
+    struct CachedUniform {
+        int location;
+        //False until the first upload, e.g. for entries created by reflect()
+        bool hasValue;
+        size_t size;
+        unsigned char value[sizeof(glm::mat4)];
+    };
+    //Indexed by handle
+    mutable std::vector<CachedUniform> m_uniformCache;
+    mutable std::unordered_map<std::string, int> m_uniformHandles;
+    mutable unsigned long long m_uniformHits = 0;
+    mutable unsigned long long m_uniformMisses = 0;
+    static unsigned long long s_totalUniformHits;
+    static unsigned long long s_totalUniformMisses;
+    //Updates the shadow copy. Returns true if the value changed and must be uploaded to location
+    bool isUniformDirty(int handle, const void* value, size_t size, int& location) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,468 @@
+#include "ShaderOptimizer.h"
+
+#include <cstring>
+#include <regex>
+#include <unordered_map>
+#include <unordered_set>
+
+bool ShaderOptimizer::s_stripEnabled = true;
+
+namespace {
+
+//Whether a line is compiled with the defines known at load time
+enum LineState {
+    LINE_ACTIVE,
+    LINE_INACTIVE,
+    //Inside #if/#elif, which isn't evaluated. Counted as a use but never removed
+    LINE_UNKNOWN
+};
+
+enum Condition {
+    CONDITION_FALSE,
+    CONDITION_TRUE,
+    CONDITION_UNKNOWN
+};
+
+//One #if..#endif level while walking the source
+struct ConditionalFrame {
+    //State of the block containing the #if
+    LineState outer;
+    //State of the current branch
+    LineState state;
+    //True once a branch is known to be taken, so later #elif/#else are inactive
+    bool taken;
+    //True if a branch couldn't be evaluated, so #else can't be resolved either
+    bool unknown;
+};
+
+struct Stage {
+    //Original text per line
+    std::vector<std::string> lines;
+    //Same lines with comments removed
+    std::vector<std::string> code;
+    std::vector<LineState> states;
+    std::vector<bool> directives;
+    //Occurrences of every identifier in lines that may be compiled
+    std::unordered_map<std::string, int> counts;
+    //User defined functions. They may write globals, so calls to them are never dropped
+    std::unordered_set<std::string> functions;
+};
+
+const char* TYPE_PATTERN = "(float|int|uint|bool|[biu]?vec[234]|mat[234](?:x[234])?)";
+
+const std::regex& declarationRegex()
+{
+    static const std::regex regex(std::string("^\\s*(?:const\\s+|highp\\s+|mediump\\s+|lowp\\s+)*") + TYPE_PATTERN
+        + "\\s+([A-Za-z_]\\w*)\\s*=\\s*([^;]+);\\s*$");
+    return regex;
+}
+
+const std::regex& assignmentRegex()
+{
+    static const std::regex regex("^\\s*([A-Za-z_]\\w*)\\s*=\\s*([^;=][^;]*);\\s*$");
+    return regex;
+}
+
+const std::regex& varyingRegex(bool output)
+{
+    static const std::regex outRegex(std::string("^\\s*(?:layout\\s*\\([^)]*\\)\\s*)?(?:flat\\s+|smooth\\s+|noperspective\\s+|centroid\\s+)*out\\s+")
+        + TYPE_PATTERN + "\\s+([A-Za-z_]\\w*)\\s*;\\s*$");
+    static const std::regex inRegex(std::string("^\\s*(?:layout\\s*\\([^)]*\\)\\s*)?(?:flat\\s+|smooth\\s+|noperspective\\s+|centroid\\s+)*in\\s+")
+        + TYPE_PATTERN + "\\s+([A-Za-z_]\\w*)\\s*;\\s*$");
+    return output ? outRegex : inRegex;
+}
+
+const std::regex& functionRegex()
+{
+    static const std::regex regex("^\\s*\\w+\\s+([A-Za-z_]\\w*)\\s*\\([^;]*$");
+    return regex;
+}
+
+int getComponentCount(const std::string& type)
+{
+    if (type.find("mat") != std::string::npos) {
+        int columns = type[3] - '0';
+        int rows = type.size() > 5 ? type[5] - '0' : columns;
+        return columns * rows;
+    }
+    if (type.find("vec") != std::string::npos)
+        return type.back() - '0';
+    return 1;
+}
+
+bool isIdentifierChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+template<typename Func>
+void forEachIdentifier(const std::string& text, Func func)
+{
+    size_t i = 0;
+    while (i < text.size()) {
+        if (isIdentifierChar(text[i])) {
+            size_t start = i;
+            while (i < text.size() && isIdentifierChar(text[i]))
+                i++;
+            //Skip numeric literals like 1.0f or 0x10
+            if (!(text[start] >= '0' && text[start] <= '9'))
+                func(text.substr(start, i - start));
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+int countIdentifier(const std::string& text, const std::string& name)
+{
+    int count = 0;
+    forEachIdentifier(text, [&](const std::string& identifier) {
+        if (identifier == name)
+            count++;
+    });
+    return count;
+}
+
+std::string getDirectiveArgument(const std::string& code, size_t keywordEnd)
+{
+    size_t start = code.find_first_not_of(" \t", keywordEnd);
+    if (start == std::string::npos)
+        return std::string();
+    size_t end = start;
+    while (end < code.size() && isIdentifierChar(code[end]))
+        end++;
+    return code.substr(start, end - start);
+}
+
+LineState combine(LineState enclosing, LineState branch)
+{
+    if (enclosing == LINE_INACTIVE || branch == LINE_INACTIVE)
+        return LINE_INACTIVE;
+    if (enclosing == LINE_UNKNOWN || branch == LINE_UNKNOWN)
+        return LINE_UNKNOWN;
+    return LINE_ACTIVE;
+}
+
+//Names the driver or the GLSL spec may predefine, e.g. GL_ARB_shading_language_420pack or __VERSION__
+bool isReservedMacro(const std::string& name)
+{
+    return name.compare(0, 3, "GL_") == 0 || name.find("__") != std::string::npos;
+}
+
+//Splits into lines, strips comments and resolves which lines are compiled.
+//A macro is only resolved if the source defines or undefines it first, or it is listed in undefinedMacros
+Stage parseStage(const std::string& source, const std::vector<std::string>& undefinedMacros)
+{
+    Stage stage;
+    size_t start = 0;
+    while (true) {
+        size_t end = source.find('\n', start);
+        stage.lines.push_back(source.substr(start, end == std::string::npos ? std::string::npos : end - start));
+        if (end == std::string::npos)
+            break;
+        start = end + 1;
+    }
+
+    bool inBlockComment = false;
+    for (const std::string& line : stage.lines) {
+        std::string code;
+        for (size_t i = 0; i < line.size(); i++) {
+            if (inBlockComment) {
+                if (line.compare(i, 2, "*/") == 0) {
+                    inBlockComment = false;
+                    i++;
+                }
+            }
+            else if (line.compare(i, 2, "//") == 0) {
+                break;
+            }
+            else if (line.compare(i, 2, "/*") == 0) {
+                inBlockComment = true;
+                i++;
+            }
+            else {
+                code += line[i];
+            }
+        }
+        stage.code.push_back(code);
+    }
+
+    std::unordered_set<std::string> defined;
+    //Macros known to be undefined. Any other macro may still be defined by the driver
+    std::unordered_set<std::string> undefined;
+    for (const std::string& name : undefinedMacros) {
+        if (!isReservedMacro(name))
+            undefined.insert(name);
+    }
+    //Macros defined or undefined inside unresolved branches
+    std::unordered_set<std::string> uncertain;
+    std::vector<ConditionalFrame> frames;
+    for (const std::string& code : stage.code) {
+        LineState current = frames.empty() ? LINE_ACTIVE : frames.back().state;
+        size_t hash = code.find_first_not_of(" \t");
+        bool directive = hash != std::string::npos && code[hash] == '#';
+        stage.directives.push_back(directive);
+        if (!directive) {
+            stage.states.push_back(current);
+            continue;
+        }
+
+        size_t keywordStart = code.find_first_not_of(" \t", hash + 1);
+        size_t keywordEnd = keywordStart;
+        while (keywordEnd < code.size() && isIdentifierChar(code[keywordEnd]))
+            keywordEnd++;
+        std::string keyword = keywordStart == std::string::npos ? std::string() : code.substr(keywordStart, keywordEnd - keywordStart);
+        std::string argument = getDirectiveArgument(code, keywordEnd);
+
+        if (keyword == "ifdef" || keyword == "ifndef" || keyword == "if") {
+            Condition condition = CONDITION_UNKNOWN;
+            bool known = defined.count(argument) || undefined.count(argument);
+            if (keyword != "if" && known && !uncertain.count(argument) && !isReservedMacro(argument)) {
+                bool isDefined = defined.count(argument) != 0;
+                condition = (isDefined == (keyword == "ifdef")) ? CONDITION_TRUE : CONDITION_FALSE;
+            }
+            LineState branch = condition == CONDITION_TRUE ? LINE_ACTIVE : (condition == CONDITION_FALSE ? LINE_INACTIVE : LINE_UNKNOWN);
+            //The directive itself belongs to the enclosing block
+            stage.states.push_back(current);
+            frames.push_back({ current, combine(current, branch), condition == CONDITION_TRUE, condition == CONDITION_UNKNOWN });
+            continue;
+        }
+        if (keyword == "elif" || keyword == "else" || keyword == "endif") {
+            if (frames.empty()) {
+                stage.states.push_back(current);
+                continue;
+            }
+            ConditionalFrame& frame = frames.back();
+            stage.states.push_back(frame.outer);
+            if (keyword == "endif") {
+                frames.pop_back();
+                continue;
+            }
+
+            LineState next;
+            if (frame.taken)
+                next = LINE_INACTIVE;
+            else if (keyword == "elif" || frame.unknown)
+                next = LINE_UNKNOWN;
+            else
+                next = LINE_ACTIVE;
+            frame.state = combine(frame.outer, next);
+            frame.unknown = frame.unknown || keyword == "elif";
+            continue;
+        }
+
+        stage.states.push_back(current);
+        if (keyword == "define" || keyword == "undef") {
+            if (current == LINE_ACTIVE) {
+                if (keyword == "define") {
+                    defined.insert(argument);
+                    undefined.erase(argument);
+                }
+                else {
+                    defined.erase(argument);
+                    undefined.insert(argument);
+                }
+            }
+            else if (current == LINE_UNKNOWN) {
+                uncertain.insert(argument);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < stage.code.size(); i++) {
+        if (stage.states[i] == LINE_INACTIVE)
+            continue;
+        std::smatch match;
+        if (!stage.directives[i] && std::regex_search(stage.code[i], match, functionRegex()))
+            stage.functions.insert(match[1].str());
+    }
+    return stage;
+}
+
+void countIdentifiers(Stage& stage)
+{
+    stage.counts.clear();
+    for (size_t i = 0; i < stage.code.size(); i++) {
+        if (stage.states[i] == LINE_INACTIVE)
+            continue;
+        forEachIdentifier(stage.code[i], [&](const std::string& identifier) {
+            stage.counts[identifier]++;
+        });
+    }
+}
+
+int getCount(const Stage& stage, const std::string& name)
+{
+    auto it = stage.counts.find(name);
+    return it == stage.counts.end() ? 0 : it->second;
+}
+
+//True if evaluating expression can't change anything besides its result
+bool isPure(const Stage& stage, const std::string& expression)
+{
+    if (expression.find("++") != std::string::npos || expression.find("--") != std::string::npos)
+        return false;
+    for (size_t i = 0; i < expression.size(); i++) {
+        if (expression[i] != '=')
+            continue;
+        char prev = i > 0 ? expression[i - 1] : ' ';
+        char next = i + 1 < expression.size() ? expression[i + 1] : ' ';
+        if (next != '=' && prev != '=' && prev != '!' && prev != '<' && prev != '>')
+            return false;
+    }
+    bool callsUserFunction = false;
+    forEachIdentifier(expression, [&](const std::string& identifier) {
+        if (stage.functions.count(identifier))
+            callsUserFunction = true;
+    });
+    return !callsUserFunction;
+}
+
+bool endsWithKeyword(const std::string& code, const char* keyword)
+{
+    size_t length = strlen(keyword);
+    if (code.size() < length || code.compare(code.size() - length, length, keyword) != 0)
+        return false;
+    return code.size() == length || !isIdentifierChar(code[code.size() - length - 1]);
+}
+
+//True if the line is the body of an if/for/while/else/do without braces, e.g. the second line of "if (b)\n x = 1;"
+bool isUnbracedBody(const Stage& stage, size_t index)
+{
+    for (size_t i = index; i-- > 0;) {
+        if (stage.states[i] == LINE_INACTIVE || stage.directives[i])
+            continue;
+        const std::string& code = stage.code[i];
+        size_t end = code.find_last_not_of(" \t\r");
+        if (end == std::string::npos)
+            continue;
+        std::string trimmed = code.substr(0, end + 1);
+        //A statement never ends in ')', so this is a control header, possibly split over several lines
+        return trimmed.back() == ')' || endsWithKeyword(trimmed, "else") || endsWithKeyword(trimmed, "do");
+    }
+    return false;
+}
+
+void removeLine(Stage& stage, size_t index, ShaderOptimizerReport& report)
+{
+    report.lines++;
+    if (isUnbracedBody(stage, index)) {
+        //Blanking the line would make the next statement the body. Leave an empty statement instead
+        std::string& line = stage.lines[index];
+        std::string indent = line.substr(0, line.find_first_not_of(" \t"));
+        report.bytes += line.size() - (indent.size() + 1);
+        line = indent + ";";
+        stage.code[index] = ";";
+        return;
+    }
+    report.bytes += stage.lines[index].size() + 1;
+    stage.lines[index].clear();
+    stage.code[index].clear();
+    stage.states[index] = LINE_INACTIVE;
+}
+
+//Vertex outputs with no reader in the fragment stage. Returns true if anything was removed
+bool removeUnusedVaryings(Stage& vertex, Stage& fragment, ShaderOptimizerReport& report)
+{
+    bool changed = false;
+    for (size_t i = 0; i < vertex.code.size(); i++) {
+        std::smatch match;
+        if (vertex.states[i] != LINE_ACTIVE || !std::regex_search(vertex.code[i], match, varyingRegex(true)))
+            continue;
+        std::string type = match[1].str();
+        std::string name = match[2].str();
+
+        //Fragment inputs of the same name. A read anywhere else keeps the varying alive
+        std::vector<size_t> fragmentLines;
+        bool removable = true;
+        for (size_t j = 0; j < fragment.code.size() && removable; j++) {
+            std::smatch inMatch;
+            if (fragment.states[j] == LINE_INACTIVE || !std::regex_search(fragment.code[j], inMatch, varyingRegex(false)) || inMatch[2].str() != name)
+                continue;
+            if (fragment.states[j] != LINE_ACTIVE)
+                removable = false;
+            fragmentLines.push_back(j);
+        }
+        if (!removable || getCount(fragment, name) > (int)fragmentLines.size())
+            continue;
+
+        //Every use in the vertex stage must be the declaration or a plain assignment
+        std::vector<size_t> vertexLines = { i };
+        int covered = 1;
+        for (size_t j = 0; j < vertex.code.size(); j++) {
+            std::smatch assignMatch;
+            if (j == i || vertex.states[j] != LINE_ACTIVE || !std::regex_search(vertex.code[j], assignMatch, assignmentRegex()))
+                continue;
+            if (assignMatch[1].str() != name || !isPure(vertex, assignMatch[2].str()))
+                continue;
+            vertexLines.push_back(j);
+            covered += countIdentifier(vertex.code[j], name);
+        }
+        if (covered != getCount(vertex, name))
+            continue;
+
+        for (size_t line : vertexLines)
+            removeLine(vertex, line, report);
+        for (size_t line : fragmentLines)
+            removeLine(fragment, line, report);
+        report.unusedVaryings.push_back(name);
+        report.varyingComponents += getComponentCount(type);
+        changed = true;
+    }
+    return changed;
+}
+
+//Initialized variables that are never read. Returns true if anything was removed
+bool removeDeadVariables(Stage& stage, ShaderOptimizerReport& report)
+{
+    bool changed = false;
+    for (size_t i = 0; i < stage.code.size(); i++) {
+        std::smatch match;
+        if (stage.states[i] != LINE_ACTIVE || stage.directives[i] || !std::regex_search(stage.code[i], match, declarationRegex()))
+            continue;
+        std::string name = match[2].str();
+        if (getCount(stage, name) != 1 || !isPure(stage, match[3].str()))
+            continue;
+        removeLine(stage, i, report);
+        report.deadVariables.push_back(name);
+        changed = true;
+    }
+    return changed;
+}
+
+std::string joinLines(const Stage& stage)
+{
+    std::string result;
+    for (size_t i = 0; i < stage.lines.size(); i++) {
+        if (i > 0)
+            result += '\n';
+        result += stage.lines[i];
+    }
+    return result;
+}
+
+}
+
+ShaderOptimizerReport ShaderOptimizer::Optimize(std::string& vertexCode, std::string& fragmentCode, const std::vector<std::string>& undefinedMacros)
+{
+    ShaderOptimizerReport report;
+    Stage vertex = parseStage(vertexCode, undefinedMacros);
+    Stage fragment = parseStage(fragmentCode, undefinedMacros);
+
+    //Removing one thing can leave the variables it read unused, so repeat until nothing changes
+    bool changed = true;
+    while (changed) {
+        countIdentifiers(vertex);
+        countIdentifiers(fragment);
+        changed = removeUnusedVaryings(vertex, fragment, report);
+        changed |= removeDeadVariables(vertex, report);
+        changed |= removeDeadVariables(fragment, report);
+    }
+
+    if (s_stripEnabled && !report.IsEmpty()) {
+        vertexCode = joinLines(vertex);
+        fragmentCode = joinLines(fragment);
+    }
+    return report;
+}
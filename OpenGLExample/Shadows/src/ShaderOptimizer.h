@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+#include <vector>
+
+/// <summary>
+/// What ShaderOptimizer found (and removed, unless stripping is disabled) in one vertex + fragment pair
+/// </summary>
+struct ShaderOptimizerReport {
+    //Vertex outputs the fragment stage never reads
+    std::vector<std::string> unusedVaryings;
+    //Interpolated components freed by dropping unusedVaryings, e.g. 3 for a vec3
+    int varyingComponents = 0;
+    //Locals and globals that are initialized but never read
+    std::vector<std::string> deadVariables;
+    size_t lines = 0;
+    size_t bytes = 0;
+
+    inline bool IsEmpty() const { return unusedVaryings.empty() && deadVariables.empty(); }
+};
+
+/// <summary>
+/// Load-time cleanup of GLSL sources after #includes and defines have been resolved.
+/// Removes vertex outputs the fragment stage never reads, along with their assignments,
+/// and single-line variable declarations whose value is never read.
+/// Only code in branches that #ifdef/#ifndef/#else resolve statically is touched; anything inside #if is left alone.
+/// A macro counts as resolved once the source defines or undefines it, or if the caller lists it as undefined.
+/// Any other macro, including GL_ and __ prefixed names the driver predefines, is unknown, so nothing under it is removed.
+/// Removed lines are blanked rather than deleted so compiler errors keep their line numbers.
+/// </summary>
+class ShaderOptimizer {
+public:
+    /// <summary>
+    /// Analyzes both stages and, if stripping is enabled, rewrites them in place.
+    /// </summary>
+    /// <param name="undefinedMacros">Macros known to be left undefined, e.g. the disabled features of a variant</param>
+    static ShaderOptimizerReport Optimize(std::string& vertexCode, std::string& fragmentCode, const std::vector<std::string>& undefinedMacros = {});
+    //When disabled, Optimize only reports what it would remove
+    static void SetStripEnabled(bool enabled) { s_stripEnabled = enabled; }
+    static bool IsStripEnabled() { return s_stripEnabled; }
+private:
+    static bool s_stripEnabled;
+};
@@ -0,0 +1,230 @@
+#include "ShaderOptimizerTests.h"
+#include "ShaderOptimizer.h"
+
+#include <iostream>
+#include <string>
+
+namespace {
+
+struct TestCase {
+    const char* name;
+    const char* vertex;
+    const char* fragment;
+    std::vector<std::string> undefinedMacros;
+    //Each must still appear in the optimized stage
+    std::vector<std::string> keptVertex;
+    std::vector<std::string> keptFragment;
+    //Each must be gone from it
+    std::vector<std::string> removedVertex;
+    std::vector<std::string> removedFragment;
+};
+
+const TestCase TEST_CASES[] = {
+    {
+        "unused varying and dead variable",
+        "#version 330 core\n"
+        "out vec3 Color;\n"
+        "out vec2 TexCoords;\n"
+        "void main() {\n"
+        "    Color = vec3(1.0);\n"
+        "    TexCoords = vec2(0.0);\n"
+        "    gl_Position = vec4(0.0);\n"
+        "}\n",
+        "#version 330 core\n"
+        "in vec3 Color;\n"
+        "in vec2 TexCoords;\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "    float unused = 2.0;\n"
+        "    FragColor = vec4(TexCoords, 0.0, 1.0);\n"
+        "}\n",
+        {},
+        { "out vec2 TexCoords;" }, { "in vec2 TexCoords;" },
+        { "out vec3 Color;", "Color = vec3(1.0);" }, { "in vec3 Color;", "float unused" }
+    },
+    {
+        //Driver extensions are defined without the source knowing, so uses under them must keep their declarations
+        "varying under a driver extension",
+        "#version 330 core\n"
+        "out float Extra;\n"
+        "void main() {\n"
+        "    Extra = 1.0;\n"
+        "    gl_Position = vec4(0.0);\n"
+        "}\n",
+        "#version 330 core\n"
+        "in float Extra;\n"
+        "#ifdef GL_ARB_shading_language_420pack\n"
+        "uniform float scale;\n"
+        "#endif\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "    float k = 2.0;\n"
+        "    FragColor = vec4(1.0);\n"
+        "#ifdef GL_ARB_shading_language_420pack\n"
+        "    FragColor = vec4(Extra * k * scale, 1.0);\n"
+        "#endif\n"
+        "}\n",
+        {},
+        { "out float Extra;", "Extra = 1.0;" }, { "in float Extra;", "uniform float scale;", "float k = 2.0;", "Extra * k * scale" },
+        {}, {}
+    },
+    {
+        //Listing GL_ names as undefined doesn't make them known either
+        "driver extension listed as undefined",
+        "#version 330 core\n"
+        "out float Extra;\n"
+        "void main() {\n"
+        "    Extra = 1.0;\n"
+        "    gl_Position = vec4(0.0);\n"
+        "}\n",
+        "#version 330 core\n"
+        "in float Extra;\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "#ifndef GL_core_profile\n"
+        "    FragColor = vec4(Extra);\n"
+        "#endif\n"
+        "}\n",
+        { "GL_core_profile" },
+        { "out float Extra;", "Extra = 1.0;" }, { "in float Extra;" },
+        {}, {}
+    },
+    {
+        "macro the source never defines",
+        "#version 330 core\n"
+        "out float Fog;\n"
+        "void main() {\n"
+        "    Fog = 1.0;\n"
+        "    gl_Position = vec4(0.0);\n"
+        "}\n",
+        "#version 330 core\n"
+        "in float Fog;\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "    FragColor = vec4(1.0);\n"
+        "#ifdef USE_FOG\n"
+        "    FragColor *= Fog;\n"
+        "#endif\n"
+        "}\n",
+        {},
+        { "out float Fog;", "Fog = 1.0;" }, { "in float Fog;", "FragColor *= Fog;" },
+        {}, {}
+    },
+    {
+        //Variants list their disabled features, so code under them is still stripped
+        "disabled variant feature",
+        "#version 330 core\n"
+        "out float Fog;\n"
+        "void main() {\n"
+        "    Fog = 1.0;\n"
+        "    gl_Position = vec4(0.0);\n"
+        "}\n",
+        "#version 330 core\n"
+        "in float Fog;\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "    FragColor = vec4(1.0);\n"
+        "#ifdef USE_FOG\n"
+        "    FragColor *= Fog;\n"
+        "#endif\n"
+        "}\n",
+        { "USE_FOG" },
+        {}, {},
+        { "out float Fog;", "Fog = 1.0;" }, { "in float Fog;" }
+    },
+    {
+        "macro defined in the source",
+        "#version 330 core\n"
+        "#define USE_FOG\n"
+        "out float Fog;\n"
+        "void main() {\n"
+        "    Fog = 1.0;\n"
+        "    gl_Position = vec4(0.0);\n"
+        "}\n",
+        "#version 330 core\n"
+        "#undef USE_FOG\n"
+        "in float Fog;\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "    FragColor = vec4(1.0);\n"
+        "#ifdef USE_FOG\n"
+        "    FragColor *= Fog;\n"
+        "#endif\n"
+        "}\n",
+        {},
+        {}, {},
+        { "out float Fog;" }, { "in float Fog;" }
+    },
+    {
+        //Blanking the body would make the next statement conditional
+        "statement under an if without braces",
+        "#version 330 core\n"
+        "uniform bool b;\n"
+        "out vec3 Color;\n"
+        "void main() {\n"
+        "    if (b)\n"
+        "        Color = vec3(1.0);\n"
+        "    gl_Position = vec4(0.0);\n"
+        "}\n",
+        "#version 330 core\n"
+        "in vec3 Color;\n"
+        "out vec4 FragColor;\n"
+        "void main() {\n"
+        "    if (gl_FrontFacing)\n"
+        "        FragColor = vec4(1.0);\n"
+        "    else\n"
+        "        float unused = 2.0;\n"
+        "    FragColor = vec4(0.5);\n"
+        "}\n",
+        {},
+        { "if (b)\n        ;\n    gl_Position" }, { "else\n        ;\n    FragColor = vec4(0.5);" },
+        { "out vec3 Color;", "Color = vec3(1.0);" }, { "in vec3 Color;", "float unused" }
+    }
+};
+
+bool checkStage(const TestCase& test, const char* stageName, const std::string& code,
+    const std::vector<std::string>& kept, const std::vector<std::string>& removed)
+{
+    bool passed = true;
+    for (const std::string& text : kept)
+    {
+        if (code.find(text) == std::string::npos) {
+            std::cout << "  FAILED " << test.name << ": " << stageName << " lost \"" << text << "\"" << std::endl;
+            passed = false;
+        }
+    }
+    for (const std::string& text : removed)
+    {
+        if (code.find(text) != std::string::npos) {
+            std::cout << "  FAILED " << test.name << ": " << stageName << " kept \"" << text << "\"" << std::endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+}
+
+int RunShaderOptimizerTests()
+{
+    bool stripEnabled = ShaderOptimizer::IsStripEnabled();
+    ShaderOptimizer::SetStripEnabled(true);
+
+    int failed = 0;
+    int count = 0;
+    for (const TestCase& test : TEST_CASES)
+    {
+        std::string vertex = test.vertex;
+        std::string fragment = test.fragment;
+        ShaderOptimizer::Optimize(vertex, fragment, test.undefinedMacros);
+        bool passed = checkStage(test, "vertex", vertex, test.keptVertex, test.removedVertex);
+        passed &= checkStage(test, "fragment", fragment, test.keptFragment, test.removedFragment);
+        if (!passed)
+            failed++;
+        count++;
+    }
+
+    ShaderOptimizer::SetStripEnabled(stripEnabled);
+    std::cout << "ShaderOptimizer: " << count - failed << " of " << count << " cases passed" << std::endl;
+    return failed;
+}
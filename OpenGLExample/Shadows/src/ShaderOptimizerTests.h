@@ -0,0 +1,8 @@
+#pragma once
+
+/// <summary>
+/// Checks ShaderOptimizer against small vertex + fragment pairs and prints each failing case.
+/// CPU only, needs no GL context. Run with the --test-shader-optimizer command line argument.
+/// Returns the number of failed cases.
+/// </summary>
+int RunShaderOptimizerTests();
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+
+//Program interface queried after linking. See Shader::getAttributes/getUniforms/getUniformBlocks
+
+struct ShaderAttribute {
+    std::string name;
+    //GL type enum, e.g. GL_FLOAT_VEC3
+    unsigned int type;
+    int location;
+};
+
+struct ShaderUniform {
+    std::string name;
+    unsigned int type;
+    //-1 for members of uniform blocks
+    int location;
+    //Index into Shader::getUniformBlocks, -1 for default block uniforms
+    int blockIndex;
+};
+
+struct ShaderUniformBlock {
+    std::string name;
+    int dataSize;
+    unsigned int binding;
+};
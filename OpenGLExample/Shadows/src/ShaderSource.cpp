@@ -0,0 +1,134 @@
+#include "ShaderSource.h"
+#include "EmbeddedShaders.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+std::unordered_map<std::string, std::string> ShaderSource::s_expanded;
+
+bool ShaderSource::Get(const std::string& path, std::string& source)
+{
+    std::string normalized = normalizePath(path);
+    auto it = s_expanded.find(normalized);
+    if (it != s_expanded.end()) {
+        source = it->second;
+        return true;
+    }
+
+    std::unordered_set<std::string> included;
+    std::string expanded;
+    if (!expand(normalized, included, expanded)) {
+        source.clear();
+        return false;
+    }
+    s_expanded[normalized] = expanded;
+    source = expanded;
+    return true;
+}
+
+void ShaderSource::ClearCache()
+{
+    s_expanded.clear();
+}
+
+bool ShaderSource::readRaw(const std::string& path, std::string& source)
+{
+#ifndef SHADERS_FROM_DISK
+    for (unsigned int i = 0; i < NUM_EMBEDDED_SHADERS; i++)
+    {
+        if (path == EMBEDDED_SHADERS[i].path) {
+            source = EMBEDDED_SHADERS[i].source;
+            return true;
+        }
+    }
+    return false;
+#else
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    source = stream.str();
+    return true;
+#endif
+}
+
+bool ShaderSource::expand(const std::string& path, std::unordered_set<std::string>& included, std::string& result)
+{
+    //Each file is pasted once, like #pragma once
+    if (included.count(path))
+        return true;
+    included.insert(path);
+
+    std::string raw;
+    if (!readRaw(path, raw)) {
+        std::cout << "ERROR::SHADER_SOURCE::NOT_FOUND " << path << std::endl;
+        return false;
+    }
+
+    std::istringstream stream(raw);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(stream, line))
+    {
+        lineNumber++;
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+            result += line;
+            result += '\n';
+            continue;
+        }
+
+        size_t open = line.find('"', start);
+        size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+        if (close == std::string::npos) {
+            std::cout << "ERROR::SHADER_SOURCE::BAD_INCLUDE " << path << ":" << lineNumber << std::endl;
+            return false;
+        }
+        std::string includePath = normalizePath(getDirectory(path) + line.substr(open + 1, close - open - 1));
+        if (!expand(includePath, included, result))
+            return false;
+        //Restore line numbering of this file for compiler messages
+        result += "#line " + std::to_string(lineNumber + 1) + "\n";
+    }
+    return true;
+}
+
+std::string ShaderSource::getDirectory(const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+std::string ShaderSource::normalizePath(const std::string& path)
+{
+    //Use forward slashes and collapse "." and ".." so every file has one key
+    std::vector<std::string> parts;
+    std::string part;
+    std::string unified = path;
+    for (char& c : unified)
+    {
+        if (c == '\\')
+            c = '/';
+    }
+    std::istringstream stream(unified);
+    while (std::getline(stream, part, '/'))
+    {
+        if (part.empty() || part == ".")
+            continue;
+        if (part == ".." && !parts.empty() && parts.back() != "..")
+            parts.pop_back();
+        else
+            parts.push_back(part);
+    }
+    std::string result;
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        if (i > 0)
+            result += '/';
+        result += parts[i];
+    }
+    return result;
+}
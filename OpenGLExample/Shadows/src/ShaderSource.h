@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+/// <summary>
+/// Provides GLSL source text by path, e.g. "shaders/defaultLit.frag".
+/// Sources come from EmbeddedShaders.h (generated by tools/embed_shaders.py at build time), so no file I/O happens at runtime.
+/// Define SHADERS_FROM_DISK to read the shaders/ folder instead while iterating on shaders.
+/// #include "path" lines are resolved relative to the including file, each file at most once per program,
+/// and expanded text is cached per path.
+/// </summary>
+class ShaderSource {
+public:
+    /// <summary>
+    /// Returns the fully expanded source for path. Returns false and leaves source empty if it can't be found
+    /// </summary>
+    static bool Get(const std::string& path, std::string& source);
+    //Drops all cached text, e.g. after editing shaders on disk
+    static void ClearCache();
+private:
+    //Expanded sources by path
+    static std::unordered_map<std::string, std::string> s_expanded;
+
+    static bool readRaw(const std::string& path, std::string& source);
+    static bool expand(const std::string& path, std::unordered_set<std::string>& included, std::string& result);
+    static std::string getDirectory(const std::string& path);
+    static std::string normalizePath(const std::string& path);
+};
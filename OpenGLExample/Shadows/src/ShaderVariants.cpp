@@ -0,0 +1,58 @@
+#include "ShaderVariants.h"
+
+ShaderVariants::ShaderVariants(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& featureDefines,
+    const std::function<void(Shader&)>& onCreate)
+    : m_vertexPath(vertexPath), m_fragmentPath(fragmentPath), m_featureDefines(featureDefines), m_onCreate(onCreate)
+{
+}
+
+Shader& ShaderVariants::Get(unsigned int features)
+{
+    features &= getSupportedMask();
+    auto it = m_variants.find(features);
+    if (it != m_variants.end())
+        return *it->second;
+
+    //Not requested ahead of time, compile now
+    Shader* shader = new Shader(m_vertexPath.c_str(), m_fragmentPath.c_str(), false, getDefines(features), getDefines(~features));
+    m_variants[features] = std::unique_ptr<Shader>(shader);
+    if (m_onCreate)
+        m_onCreate(*shader);
+    return *shader;
+}
+
+void ShaderVariants::Precompile(const std::vector<unsigned int>& featureSets)
+{
+    std::vector<Shader*> batch;
+    for (unsigned int features : featureSets)
+    {
+        features &= getSupportedMask();
+        if (m_variants.count(features))
+            continue;
+        Shader* shader = new Shader(m_vertexPath.c_str(), m_fragmentPath.c_str(), true, getDefines(features), getDefines(~features));
+        m_variants[features] = std::unique_ptr<Shader>(shader);
+        batch.push_back(shader);
+    }
+    Shader::compileBatch(batch);
+
+    if (m_onCreate) {
+        for (Shader* shader : batch)
+            m_onCreate(*shader);
+    }
+}
+
+unsigned int ShaderVariants::getSupportedMask() const
+{
+    return (1u << m_featureDefines.size()) - 1;
+}
+
+std::vector<std::string> ShaderVariants::getDefines(unsigned int features) const
+{
+    std::vector<std::string> defines;
+    for (size_t i = 0; i < m_featureDefines.size(); i++)
+    {
+        if (features & (1u << i))
+            defines.push_back(m_featureDefines[i]);
+    }
+    return defines;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Shader.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Preprocessor permutations of one vertex/fragment program pair.
+/// Each bit of a feature mask enables the matching entry of featureDefines.
+/// Variants are built on first use (or ahead of time with Precompile) and cached by mask.
+/// </summary>
+class ShaderVariants {
+public:
+    /// <param name="featureDefines">Define for each feature bit, lowest bit first</param>
+    /// <param name="onCreate">Called once per new variant, e.g. to bind uniform blocks and sampler units</param>
+    ShaderVariants(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& featureDefines,
+        const std::function<void(Shader&)>& onCreate = nullptr);
+    /// <summary>
+    /// Returns the variant for the given features, compiling it if needed.
+    /// Bits without a matching define are ignored.
+    /// </summary>
+    Shader& Get(unsigned int features);
+    /// <summary>
+    /// Builds all listed variants in one batch so they don't hitch on first use
+    /// </summary>
+    void Precompile(const std::vector<unsigned int>& featureSets);
+    inline size_t GetNumVariants() const { return m_variants.size(); }
+private:
+    std::string m_vertexPath;
+    std::string m_fragmentPath;
+    std::vector<std::string> m_featureDefines;
+    std::function<void(Shader&)> m_onCreate;
+    std::unordered_map<unsigned int, std::unique_ptr<Shader>> m_variants;
+
+    unsigned int getSupportedMask() const;
+    std::vector<std::string> getDefines(unsigned int features) const;
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <chrono>
+
+/// <summary>
+/// Wall clock stopwatch for benchmarks and CPU timings shown in the UI. Starts when constructed.
+/// Unlike CpuProfiler it works with the profiler compiled out and records nothing.
+/// </summary>
+class Timer {
+public:
+    Timer() : m_start(Clock::now()) {}
+
+    //Milliseconds since construction or the last Restart
+    float ElapsedMs() const {
+        std::chrono::duration<float, std::milli> elapsed = Clock::now() - m_start;
+        return elapsed.count();
+    }
+    //Returns ElapsedMs and starts timing again, for back to back intervals
+    float Restart() {
+        Clock::time_point now = Clock::now();
+        std::chrono::duration<float, std::milli> elapsed = now - m_start;
+        m_start = now;
+        return elapsed.count();
+    }
+private:
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point m_start;
+};
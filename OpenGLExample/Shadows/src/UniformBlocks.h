@@ -0,0 +1,51 @@
+#pragma once
+#include <glm/glm.hpp>
+
+//Binding points shared by all programs. Must match glUniformBlockBinding calls in main.cpp
+const unsigned int FRAME_DATA_BINDING = 0;
+const unsigned int OBJECT_DATA_BINDING = 1;
+const unsigned int MATERIAL_DATA_BINDING = 2;
+
+/// <summary>
+/// Per-frame camera and light constants, uploaded once per frame.
+/// Mirrors the std140 "FrameData" block declared in shaders/*.vert and shaders/*.frag.
+/// vec3 members are padded to 16 bytes as std140 requires.
+/// </summary>
+struct FrameData {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::mat4 lightSpaceMatrix;
+    glm::vec3 cameraPos;
+    float pad0;
+    glm::vec3 lightPos;
+    float pad1;
+    glm::vec3 lightColor;
+    float pad2;
+};
+
+/// <summary>
+/// Per-object constants computed once per frame on the CPU and shared by the shadow and main passes.
+/// Mirrors the std140 "ObjectData" block. All objects are uploaded in one buffer and bound by range per draw.
+/// </summary>
+struct ObjectData {
+    glm::mat4 model;
+    //Inverse transpose of the model matrix. Stored as mat4 so columns keep std140 alignment
+    glm::mat4 normalMatrix;
+    glm::mat4 mvp;
+    glm::mat4 lightMvp;
+};
+
+/// <summary>
+/// Per-material constants. Mirrors the std140 "MaterialData" block.
+/// Each Material keeps its own buffer, uploaded only when a value changes.
+/// </summary>
+struct MaterialData {
+    glm::vec2 tile;
+    float shininess;
+    float reflectivity;
+    //Weights of the ambient, diffuse and specular lighting terms
+    float ambientK;
+    float diffuseK;
+    float specularK;
+    float pad0;
+};
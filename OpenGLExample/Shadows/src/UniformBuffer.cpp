@@ -0,0 +1,51 @@
+#include "UniformBuffer.h"
+#include <GL/glew.h>
+
+UniformBuffer::UniformBuffer(size_t size, unsigned int binding) : m_binding(binding), m_size(size)
+{
+    glGenBuffers(1, &m_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+    //Allocate storage, filled every frame with SetData
+    glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    //Attach the whole buffer to its binding point
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, m_ubo);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    glDeleteBuffers(1, &m_ubo);
+}
+
+void UniformBuffer::SetData(const void* data, size_t size, size_t offset)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+    if (offset + size > m_size) {
+        //Reallocate. Previous contents are discarded
+        m_size = offset + size;
+        glBufferData(GL_UNIFORM_BUFFER, m_size, NULL, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_ubo);
+    }
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformBuffer::BindRange(size_t offset, size_t size)
+{
+    glBindBufferRange(GL_UNIFORM_BUFFER, m_binding, m_ubo, offset, size);
+}
+
+void UniformBuffer::Bind()
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_ubo);
+}
+
+size_t UniformBuffer::GetAlignedSize(size_t size)
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment <= 0)
+        return size;
+    return (size + alignment - 1) / alignment * alignment;
+}
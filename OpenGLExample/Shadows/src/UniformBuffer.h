@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+/// <summary>
+/// Uniform buffer object bound to a fixed binding point.
+/// Shader programs read from it through a matching std140 uniform block.
+/// </summary>
+class UniformBuffer {
+public:
+    UniformBuffer(size_t size, unsigned int binding);
+    ~UniformBuffer();
+    /// <summary>
+    /// Uploads data to the buffer, starting at offset bytes. Grows the buffer if needed
+    /// </summary>
+    void SetData(const void* data, size_t size, size_t offset = 0);
+    /// <summary>
+    /// Binds only part of the buffer to the binding point, e.g. one object's entry in a bulk upload.
+    /// offset must be aligned, see GetAlignedSize()
+    /// </summary>
+    void BindRange(size_t offset, size_t size);
+    //Attaches the whole buffer to its binding point again, e.g. after another buffer used the same binding
+    void Bind();
+    //Rounds size up to the driver's minimum uniform buffer offset alignment
+    static size_t GetAlignedSize(size_t size);
+    inline unsigned int GetBinding() const { return m_binding; }
+    inline size_t GetSize() const { return m_size; }
+private:
+    unsigned int m_ubo;
+    unsigned int m_binding;
+    size_t m_size;
+};
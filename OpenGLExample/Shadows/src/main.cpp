@@ -3,18 +3,44 @@
 
 #include <iostream>
 #include <vector>
+#include <cstring>
+#include <cfloat>
+#include <algorithm>
+#include <unordered_map>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #include "Shader.h"
+#include "ShaderVariants.h"
 #include "Primitive.h"
 #include "ShapeGen.h"
 #include "FlyCamera.h"
 #include "Camera.h"
+#include "GLStateCache.h"
+#include "UniformBuffer.h"
+#include "UniformBlocks.h"
+#include "RenderQueue.h"
+#include "CommandList.h"
+#include "Material.h"
+#include "FrustumCuller.h"
+#include "OcclusionCuller.h"
+#include "OcclusionQueries.h"
+#include "JobSystem.h"
+#include "EntityStore.h"
+#include "EntitySystems.h"
+#include "RenderGraph.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "BVHBenchmark.h"
+#include "OcclusionBenchmark.h"
+#include "EntityBenchmark.h"
+#include "ShaderOptimizerTests.h"
+#include "RenderGraphTests.h"
 
 void mouse_scroll_callback(GLFWwindow* window, double xOffset, double yOffset);
 void mouse_callback(GLFWwindow* window, double xPos, double yPos);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 unsigned int loadTexture(const char* filePath);
@@ -23,7 +49,21 @@ unsigned int createCubeVAO();
 unsigned int createSkyboxVAO();
 unsigned int createPlaneVAO();
 unsigned int createQuadVAO();
-void renderScene(const Shader& shader, float currentTime);
+void createScene();
+void updateScene(float currentTime, const glm::vec3& lightPosition);
+Entity addObject(Primitive* primitive, Material* material, Entity parent, const glm::vec3& position, const glm::vec3& scale,
+    unsigned int flags = 0);
+void uploadObjectData(const glm::mat4& viewProjection, const glm::mat4& lightTransform);
+void drawObject(size_t index, unsigned int attributeMask, GLuint conditionQuery = 0);
+void updateBounds();
+void cullOccluded(const glm::mat4& viewProjection);
+void issueOcclusionQueries(Shader& proxyShader, const glm::vec3& cameraPosition);
+void cullShadowCasters(const glm::mat4& lightView);
+std::vector<unsigned int> getSceneFeatureSets(unsigned int passFeatures);
+void submitScene(unsigned int pass, ShaderVariants& variants, unsigned int passFeatures, const glm::vec3& viewPosition, bool useMaterials,
+    const std::vector<uint8_t>* visible);
+void mergeCommandLists(RenderQueue& queue);
+void renderPass(RenderQueue& queue, unsigned int pass);
 
 //Time 
 float deltaTime = 0.0f;
@@ -44,11 +84,31 @@ bool firstMouse = true;
 Camera camera = Camera(glm::vec3(0), glm::vec3(0, 0, 1.0f), 60.0f, (float)SCR_WIDTH / SCR_HEIGHT);
 FlyCamera cameraController = FlyCamera(&camera, 5.0f);
 
+//Lit shader features. Bit order must match the defines passed to litShaders
+enum LitFeature : unsigned int {
+    LIT_SHADOWS = 1 << 0,
+    LIT_PCF = 1 << 1,
+    LIT_SKYBOX_REFLECTION = 1 << 2,
+    LIT_TILING = 1 << 3,
+    LIT_ALL = LIT_SHADOWS | LIT_PCF | LIT_SKYBOX_REFLECTION | LIT_TILING
+};
+//Features enabled for the main pass. Objects only get the ones their material needs. Shadows toggle with L
+unsigned int litPassFeatures = LIT_ALL;
+//Shadow map drawn in the corner, toggled with O. With shadows off as well, the shadow pass is culled
+bool showShadowMapOverlay = true;
+
 //Textures
 GLuint skyboxTexture;
 GLuint wallTexture;
 GLuint grassTexture;
 
+//Materials. Objects with different tiling need their own material
+Material* cubeMaterial;
+Material* wallMaterial;
+Material* tallWallMaterial;
+Material* groundMaterial;
+Material* lightGizmoMaterial;
+
 //Geometry
 MeshData* cubeMesh;
 Primitive* cubeRenderer;
@@ -57,8 +117,108 @@ Primitive* planeRenderer;
 MeshData* quadMesh;
 Primitive* quadRenderer;
 
-int main()
+//Objects in the scene are entities, created once. An object's index in the renderable pool is its index
+//in objectData, objectBounds and the culling results. World matrices are only recomputed for transforms that
+//changed, and both passes read them from objectData
+enum ObjectFlag : unsigned int {
+    //Large enough to hide other objects, drawn into the software depth buffer
+    OBJECT_OCCLUDER = 1 << 0,
+    //Expensive enough to be worth a hardware occlusion query on its bounding box
+    OBJECT_OCCLUSION_QUERY = 1 << 1
+};
+EntityStore entities;
+std::vector<ObjectData> objectData;
+//Number of objects submitted by submitScene. Entries after it are submitted individually
+size_t sceneObjectCount = 0;
+Entity lightGizmo;
+size_t lightGizmoIndex;
+UniformBuffer* objectDataBuffer;
+//Distance between objects in objectDataBuffer, padded to the uniform buffer offset alignment
+size_t objectDataStride;
+std::vector<unsigned char> objectDataStaging;
+
+//Draws of both passes, sorted by state once per frame
+enum RenderPass : unsigned int {
+    RENDER_PASS_SHADOW = 0,
+    RENDER_PASS_MAIN = 1,
+    RENDER_PASS_GIZMO = 2
+};
+RenderQueue renderQueue;
+//Shadow pass draws. Recorded by the shadow pass itself, so nothing is recorded when the render graph culls it
+RenderQueue shadowQueue;
+//One list per JobSystem thread. Scene draws are recorded on all threads and merged into a queue
+std::vector<CommandList> commandLists;
+//Draws merged from commandLists this frame
+size_t recordedDraws = 0;
+//Objects per job when recording draws or packing object data
+const size_t OBJECTS_PER_JOB = 64;
+
+//World space boxes of all objects, updated when they move, and which of them the camera sees
+FrustumCuller frustumCuller;
+std::vector<AABB> objectBounds;
+std::vector<uint8_t> cameraVisible;
+size_t cameraVisibleCount = 0;
+//Objects hidden behind occluders are removed from cameraVisible
+OcclusionCuller occlusionCuller;
+size_t occludedCount = 0;
+//Hardware queries for the main pass. Created once the GL context exists
+OcclusionQueries* occlusionQueries;
+//Objects that can cast a shadow onto something the camera sees
+std::vector<uint8_t> lightVisible;
+
+//Shadow map volume in light view space. Ortho, since the light is directional
+const float LIGHT_HALF_SIZE = 10.0f;
+const float LIGHT_NEAR = 1.0f;
+const float LIGHT_FAR = 15.0f;
+
+//Passes of the frame, rebuilt every frame. Owns the shadow map. Created once the GL context exists
+RenderGraph* renderGraph;
+const int SHADOWMAP_WIDTH = 2048, SHADOWMAP_HEIGHT = 2048;
+//GPU time of every render graph pass. P writes the summary to GPU_TIMINGS_PATH
+GpuProfiler* gpuProfiler;
+const char* const GPU_TIMINGS_PATH = "gpu_timings.csv";
+//CPU zones of startup and the first TRACE_FRAMES frames are captured with --trace. T starts and stops a capture
+const char* const CPU_TRACE_PATH = "cpu_trace.json";
+const int TRACE_FRAMES = 300;
+void writeCpuTrace();
+
+//Draws and triangles of each pass last frame
+struct PassStats {
+    unsigned int draws;
+    size_t triangles;
+};
+PassStats passStats[RenderQueue::MAX_PASSES] = {};
+
+int main(int argc, char** argv)
 {
+    CPU_PROFILE_THREAD("Main");
+    //CPU only benchmarks and tests run without opening a window
+    if (argc > 1 && strcmp(argv[1], "--benchmark-bvh") == 0) {
+        RunBVHBenchmark();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--benchmark-occlusion") == 0) {
+        JobSystem::Initialize();
+        RunOcclusionBenchmark();
+        JobSystem::Shutdown();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--benchmark-entities") == 0) {
+        JobSystem::Initialize();
+        RunEntityBenchmark();
+        JobSystem::Shutdown();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--test-shader-optimizer") == 0)
+        return RunShaderOptimizerTests() == 0 ? 0 : 1;
+
+    //Startup is only captured if the capture begins before it
+    int traceFramesLeft = -1;
+    if (argc > 1 && strcmp(argv[1], "--trace") == 0) {
+        CpuProfiler::Start();
+        traceFramesLeft = TRACE_FRAMES;
+    }
+
     if (!glfwInit())
         return -1;
     
@@ -67,6 +227,11 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+    //GPU tests need a context but no visible window
+    bool testRenderGraph = argc > 1 && strcmp(argv[1], "--test-render-graph") == 0;
+    if (testRenderGraph)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
     // glfw window creation
     // --------------------
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
@@ -85,23 +250,83 @@ int main()
 
     std::cout << glGetString(GL_VERSION) << std::endl;
 
+    if (testRenderGraph) {
+        int failed = RunRenderGraphTests();
+        glfwTerminate();
+        return failed == 0 ? 0 : 1;
+    }
+
+    //Workers for culling and draw recording, joined before exit
+    JobSystem::Initialize();
+    commandLists.resize(JobSystem::GetThreadCount());
+
     //Input callbacks
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetScrollCallback(window, mouse_scroll_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetKeyCallback(window, key_callback);
     //Hide + lock cursor
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-
-    Shader skyboxShader = Shader("shaders/skybox.vert", "shaders/skybox.frag");
-
-    Shader litShader = Shader("shaders/defaultLit.vert", "shaders/defaultLit.frag");
-
-    Shader debugDepthShader = Shader("shaders/debugDepth.vert", "shaders/debugDepth.frag");
-
-    Shader renderToDepthShader = Shader("shaders/renderToDepth.vert", "shaders/renderToDepth.frag");
+    GLStateCache::Enable(GL_DEPTH_TEST);
+    GLStateCache::Enable(GL_CULL_FACE);
+
+    //Compile programs together so the driver can overlap them
+    double shaderStartTime = glfwGetTime();
+
+    Shader skyboxShader = Shader("shaders/skybox.vert", "shaders/skybox.frag", true);
+
+    Shader debugDepthShader = Shader("shaders/debugDepth.vert", "shaders/debugDepth.frag", true);
+
+    Shader occlusionProxyShader = Shader("shaders/occlusionProxy.vert", "shaders/occlusionProxy.frag", true);
+
+    Shader::compileBatch({ &skyboxShader, &debugDepthShader, &occlusionProxyShader });
+    Primitive::ValidateAttributes(skyboxShader.getAttributes());
+    Primitive::ValidateAttributes(debugDepthShader.getAttributes());
+    int skyboxTextureUniform = skyboxShader.getUniformHandle("u_texture");
+    int nearPlaneUniform = debugDepthShader.getUniformHandle("near_plane");
+    int farPlaneUniform = debugDepthShader.getUniformHandle("far_plane");
+    int overlayScaleUniform = debugDepthShader.getUniformHandle("scale");
+    int overlayOffsetUniform = debugDepthShader.getUniformHandle("offset");
+    Primitive::ValidateAttributes(occlusionProxyShader.getAttributes());
+
+    //Permutations of the lit shader. Each variant gets the frame block and sampler units when created
+    ShaderVariants litShaders = ShaderVariants("shaders/defaultLit.vert", "shaders/defaultLit.frag",
+        { "USE_SHADOWS", "USE_PCF", "USE_SKYBOX_REFLECTION", "USE_TILING" },
+        [](Shader& shader) {
+            Primitive::ValidateAttributes(shader.getAttributes());
+            shader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+            shader.bindUniformBlock("ObjectData", OBJECT_DATA_BINDING);
+            shader.bindUniformBlock("MaterialData", MATERIAL_DATA_BINDING);
+            shader.use();
+            shader.setInt("u_texture", 0);
+            shader.setInt("u_skyboxTexture", 1);
+            shader.setInt("u_shadowMap", 2);
+        });
+    //Depth pass has no permutations
+    ShaderVariants depthShaders = ShaderVariants("shaders/renderToDepth.vert", "shaders/renderToDepth.frag", {},
+        [](Shader& shader) {
+            Primitive::ValidateAttributes(shader.getAttributes());
+            shader.bindUniformBlock("ObjectData", OBJECT_DATA_BINDING);
+        });
+    depthShaders.Precompile({ 0 });
+
+    //Lit variants are built once the scene's materials are known
+    float shaderLoadTime = (float)((glfwGetTime() - shaderStartTime) * 1000.0);
+
+    //Per-frame constants shared by all programs
+    UniformBuffer frameDataBuffer = UniformBuffer(sizeof(FrameData), FRAME_DATA_BINDING);
+    skyboxShader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    occlusionProxyShader.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    FrameData frameData = {};
+
+    //Per-object constants, uploaded in bulk once per frame
+    objectDataStride = UniformBuffer::GetAlignedSize(sizeof(ObjectData));
+    objectDataBuffer = new UniformBuffer(objectDataStride * 16, OBJECT_DATA_BINDING);
+
+    occlusionQueries = new OcclusionQueries();
+    renderGraph = new RenderGraph();
+    gpuProfiler = new GpuProfiler();
 
     std::vector<std::string> faces{
         "textures/skybox/right.jpg",
@@ -116,6 +341,17 @@ int main()
     wallTexture = loadTexture("textures/wall.jpg");
     grassTexture = loadTexture("textures/Grass_Color.jpg");
 
+    cubeMaterial = new Material(wallTexture, glm::vec2(0.5f));
+    wallMaterial = new Material(wallTexture, glm::vec2(2.0f));
+    tallWallMaterial = new Material(wallTexture, glm::vec2(2.0f, 3.0f));
+    groundMaterial = new Material(grassTexture, glm::vec2(5.0f));
+    lightGizmoMaterial = new Material(wallTexture);
+    //Lit variant features of each material. The light gizmo is neither shadowed nor tiled, so it needs none
+    cubeMaterial->SetShaderFeatures(LIT_SHADOWS | LIT_PCF | LIT_TILING);
+    wallMaterial->SetShaderFeatures(LIT_SHADOWS | LIT_PCF | LIT_TILING);
+    tallWallMaterial->SetShaderFeatures(LIT_SHADOWS | LIT_PCF | LIT_TILING);
+    groundMaterial->SetShaderFeatures(LIT_SHADOWS | LIT_PCF | LIT_TILING);
+
     //Create geometry
     cubeMesh = new MeshData();
     createCube(1.0f, 1.0f, 1.0f, glm::vec3(1.0f), cubeMesh);
@@ -129,45 +365,33 @@ int main()
     createQuad(2.0f, 2.0f, glm::vec3(1.0f), quadMesh);
     quadRenderer = new Primitive(quadMesh);
 
-    //Create depth buffer
-    GLuint depthMapFBO;
-    glGenFramebuffers(1, &depthMapFBO);
-    const unsigned int SHADOWMAP_WIDTH = 2048, SHADOWMAP_HEIGHT = 2048;
-
-    //Create depth texture
-    GLuint depthTexture;
-    glGenTextures(1, &depthTexture);
-    glBindTexture(GL_TEXTURE_2D, depthTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOWMAP_WIDTH, SHADOWMAP_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    createScene();
 
-    //Attach depth texture to FBO
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
-    glDrawBuffer(GL_NONE); //Tell OpenGL we aren't rendering to color buffer
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    //Create framebuffer for drawing depth to screen
-    GLuint screenFBO;
-    glGenFramebuffers(1, &screenFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);
-
-    GLuint screenTexture;
-    glGenTextures(1, &screenTexture);
-    glBindTexture(GL_TEXTURE_2D, screenTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    //Only the variants the scene's materials use. Other combinations, e.g. after toggling shadows, are built on first use
+    double variantStartTime = glfwGetTime();
+    std::vector<unsigned int> sceneFeatureSets = getSceneFeatureSets(litPassFeatures);
+    litShaders.Precompile(sceneFeatureSets);
+    shaderLoadTime += (float)((glfwGetTime() - variantStartTime) * 1000.0);
+
+    //Startup cost of all programs. Warm starts load from the program binary cache
+    bool warmStart = skyboxShader.isLoadedFromCache() && debugDepthShader.isLoadedFromCache() && occlusionProxyShader.isLoadedFromCache()
+        && depthShaders.Get(0).isLoadedFromCache();
+    for (unsigned int features : sceneFeatureSets)
+        warmStart = warmStart && litShaders.Get(features).isLoadedFromCache();
+    std::cout << (warmStart ? "Warm" : "Cold") << " start: " << sceneFeatureSets.size() << " lit variants, shaders ready in "
+        << shaderLoadTime << " ms" << std::endl;
 
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, screenTexture, 0);
+    //Shadow map, sampled with its edges repeated like the original depth texture
+    const RenderTextureDesc shadowMapDesc = { SHADOWMAP_WIDTH, SHADOWMAP_HEIGHT, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, GL_FLOAT,
+        GL_NEAREST, GL_REPEAT };
 
     //Render loop
+    float statsTimer = 0.0f;
     while (!glfwWindowShouldClose(window))
     {
+        CPU_PROFILE_FRAME();
+        if (traceFramesLeft > 0 && --traceFramesLeft == 0)
+            writeCpuTrace();
         processInput(window);
 
         //Timing
@@ -175,170 +399,435 @@ int main()
         deltaTime = currentTime - prevFrameTime;
         prevFrameTime = currentTime;
 
-        //Match viewport to shadowmap resolution
-        glViewport(0, 0, SHADOWMAP_WIDTH, SHADOWMAP_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        //Print last frame's stats once per second
+        GLStateCache::BeginFrame();
+        Material::BeginFrame();
+        occlusionQueries->BeginFrame();
+        gpuProfiler->BeginFrame();
+        statsTimer += deltaTime;
+        if (statsTimer >= 1.0f) {
+            statsTimer = 0.0f;
+            std::cout << "GL state calls: " << GLStateCache::GetIssuedCalls() << " issued, "
+                << GLStateCache::GetSkippedCalls() << " skipped" << std::endl;
+            std::cout << "Uniform uploads: " << Shader::getTotalUniformMisses() << " sent, "
+                << Shader::getTotalUniformHits() << " skipped (total)" << std::endl;
+            std::cout << "Command lists: " << recordedDraws << " draws recorded on " << commandLists.size() << " threads" << std::endl;
+            std::cout << "Render queue: " << renderQueue.GetCommandCount() + shadowQueue.GetCommandCount() << " draws, state changes "
+                << renderQueue.GetUnsortedStateChanges() + shadowQueue.GetUnsortedStateChanges() << " unsorted, "
+                << renderQueue.GetSortedStateChanges() + shadowQueue.GetSortedStateChanges() << " sorted, "
+                << Material::GetBindCount() << " material binds" << std::endl;
+            std::cout << "Entities: " << std::count(entities.transforms.changed.begin(), entities.transforms.changed.end(), 1) << " of "
+                << entities.transforms.GetCount() << " world matrices updated" << std::endl;
+            std::cout << "Frustum culling: " << cameraVisibleCount << " of " << frustumCuller.GetCount() << " objects visible ("
+                << FrustumCuller::GetBatchWidth() << " boxes per test)" << std::endl;
+            std::cout << "Occlusion culling: " << occludedCount << " objects hidden, " << occlusionCuller.GetTriangleCount()
+                << " occluder triangles rasterized in " << occlusionCuller.GetRasterizeTime() << " ms" << std::endl;
+            std::cout << "Occlusion queries: " << occlusionQueries->GetIssuedCount() << " issued, "
+                << occlusionQueries->GetSkippedDraws() << " draws skipped, " << occlusionQueries->GetPendingCount() << " results late ("
+                << occlusionQueries->GetPoolSize() << " pooled)" << std::endl;
+            std::cout << "Shadow pass: " << passStats[RENDER_PASS_SHADOW].draws << " of " << sceneObjectCount << " casters drawn, "
+                << passStats[RENDER_PASS_SHADOW].triangles << " triangles" << std::endl;
+            std::cout << "Main pass: " << passStats[RENDER_PASS_MAIN].draws << " draws, "
+                << passStats[RENDER_PASS_MAIN].triangles << " triangles" << std::endl;
+            std::cout << "Render graph: " << renderGraph->GetOrderString() << " (" << renderGraph->GetCulledCount() << " of "
+                << renderGraph->GetPassCount() << " passes culled), " << renderGraph->GetTransientCount() << " transient textures in "
+                << renderGraph->GetTextureCount() << " allocations, " << renderGraph->GetBarriers().size() << " barriers" << std::endl;
+            std::cout << "GPU time (average/p95 ms):";
+            for (const GpuProfiler::ZoneStats& zone : gpuProfiler->GetStats())
+                std::cout << " " << zone.name << " " << zone.average << "/" << zone.p95;
+            std::cout << ", " << gpuProfiler->GetLateCount() << " results late" << std::endl;
+        }
 
         glm::vec3 lightPos = glm::vec3(cos(currentTime * 0.5) * 5.0, 5.0, sin(currentTime * 0.5)*5.0);
 
-        //1. Draw geometry from light POV
-        glCullFace(GL_FRONT); //Use front face culling when rendering to depth map
-
-        glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 1.0f, 15.0f);
+        glm::mat4 lightProjection = glm::ortho(-LIGHT_HALF_SIZE, LIGHT_HALF_SIZE, -LIGHT_HALF_SIZE, LIGHT_HALF_SIZE, LIGHT_NEAR, LIGHT_FAR);
         glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         glm::mat4 lightTransform = lightProjection * lightView;
-        renderToDepthShader.use();
-        renderToDepthShader.setMat4("u_lightSpaceMatrix", lightTransform);
-        renderScene(renderToDepthShader, currentTime);
-      
-        //Draw to screen
-        glBindFramebuffer(GL_FRAMEBUFFER, 0); 
-        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        //2. Draw geometry from camera POV
+        //Upload camera and light constants once for every pass this frame
+        frameData.projection = camera.GetProjectionMatrix();
+        frameData.view = camera.GetViewMatrix();
+        frameData.lightSpaceMatrix = lightTransform;
+        frameData.cameraPos = camera.GetPosition();
+        frameData.lightPos = lightPos;
+        frameData.lightColor = glm::vec3(1.0);
+        frameDataBuffer.SetData(&frameData, sizeof(FrameData));
+
+        //Transforms for all objects, including the light gizmo
+        updateScene(currentTime, lightPos);
+        uploadObjectData(frameData.projection * frameData.view, lightTransform);
+        updateBounds();
         {
-            glCullFace(GL_BACK);
+            CPU_PROFILE_ZONE("Frustum culling");
+            cameraVisibleCount = frustumCuller.Cull(Frustum(frameData.projection * frameData.view), cameraVisible);
+        }
+        cullOccluded(frameData.projection * frameData.view);
+
+        //Queue the camera's passes up front. Each draw gets the cheapest variant with what its material needs,
+        //limited to what the pass allows. The shadow pass queues its own draws when it runs
+        recordedDraws = 0;
+        passStats[RENDER_PASS_SHADOW] = {};
+        shadowQueue.Clear();
+        submitScene(RENDER_PASS_MAIN, litShaders, litPassFeatures, frameData.cameraPos, true, &cameraVisible);
+        renderQueue.Clear();
+        mergeCommandLists(renderQueue);
+        //Light position drawn as a cube
+        if (cameraVisible[lightGizmoIndex])
+            renderQueue.Submit(RENDER_PASS_GIZMO, &litShaders.Get(lightGizmoMaterial->GetShaderFeatures() & litPassFeatures), cubeRenderer,
+                lightGizmoMaterial, lightGizmoIndex, glm::distance(frameData.cameraPos, lightPos));
+        renderQueue.Sort();
+        CPU_PROFILE_COUNTER("Visible objects", cameraVisibleCount);
+        CPU_PROFILE_COUNTER("Draws", renderQueue.GetCommandCount());
+
+        //Passes declare what they read and write. Compile drops the ones nothing consumes
+        renderGraph->Reset();
+        RenderGraph::Resource backbuffer = renderGraph->ImportBackbuffer("Backbuffer", SCR_WIDTH, SCR_HEIGHT);
+        RenderGraph::Resource shadowMap = renderGraph->CreateTexture("ShadowMap", shadowMapDesc);
 
-            litShader.use();
-            litShader.setMat4("u_lightSpaceMatrix", lightTransform);
+        //1. Draw geometry from light POV
+        renderGraph->AddPass("Shadow", [&]() {
+            //Only needed if the pass runs
+            cullShadowCasters(lightView);
+            CPU_PROFILE_COUNTER("Shadow casters", std::count(lightVisible.begin(), lightVisible.end(), 1));
+            submitScene(RENDER_PASS_SHADOW, depthShaders, 0, lightPos, false, &lightVisible);
+            mergeCommandLists(shadowQueue);
+            shadowQueue.Sort();
+
+            glClear(GL_DEPTH_BUFFER_BIT);
+            GLStateCache::CullFace(GL_FRONT); //Use front face culling when rendering to depth map
+
+            //Casters between the light and the near plane are flattened onto it instead of clipped
+            GLStateCache::Enable(GL_DEPTH_CLAMP);
+            renderPass(shadowQueue, RENDER_PASS_SHADOW);
+            GLStateCache::Disable(GL_DEPTH_CLAMP);
+        }).WriteDepth(shadowMap);
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, wallTexture);
-            litShader.setInt("u_texture", 0);
+        //2. Draw geometry from camera POV
+        RenderGraph::PassBuilder litPass = renderGraph->AddPass("Lit", [&]() {
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            GLStateCache::CullFace(GL_BACK);
 
-            glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
-            litShader.setInt("u_skyboxTexture", 1);
+            //Sampler units are set once per variant when it is created
+            GLStateCache::ActiveTexture(GL_TEXTURE1);
+            GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
 
-            glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, depthTexture);
-            litShader.setInt("u_shadowMap", 2);
+            GLStateCache::ActiveTexture(GL_TEXTURE2);
+            GLStateCache::BindTexture(GL_TEXTURE_2D, renderGraph->GetTexture(shadowMap));
 
-            litShader.setMat4("u_projection", camera.GetProjectionMatrix());
-            litShader.setMat4("u_view", camera.GetViewMatrix());
-            litShader.setVec3("u_cameraPos", camera.GetPosition());
-            litShader.setVec3("u_lightColor", glm::vec3(1.0));
-            litShader.setVec3("u_lightPos", lightPos);
+            renderPass(renderQueue, RENDER_PASS_MAIN);
 
-            renderScene(litShader, currentTime);
-        }
+            //Tested against this frame's depth, used to skip draws next frame
+            issueOcclusionQueries(occlusionProxyShader, frameData.cameraPos);
+        });
+        litPass.WriteColor(backbuffer);
+        if (litPassFeatures & LIT_SHADOWS)
+            litPass.Read(shadowMap);
 
-        //Draw light position as cube
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, lightPos);
-        model = glm::scale(model, glm::vec3(0.2f));
-        litShader.setMat4("u_model", model);
-        cubeRenderer->Draw();
+        //Light position, kept out of the occlusion queries
+        renderGraph->AddPass("LightGizmo", [&]() {
+            renderPass(renderQueue, RENDER_PASS_GIZMO);
+        }).WriteColor(backbuffer);
 
         //Draw skybox
-        {
-            glDepthFunc(GL_LEQUAL);
-            glCullFace(GL_FRONT);
+        renderGraph->AddPass("Skybox", [&]() {
+            GLStateCache::DepthFunc(GL_LEQUAL);
+            GLStateCache::CullFace(GL_FRONT);
 
             skyboxShader.use();
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
-            skyboxShader.setInt("u_texture", 0);
-            skyboxShader.setMat4("u_view", glm::mat4(glm::mat3(camera.GetViewMatrix())));
-            skyboxShader.setMat4("u_projection", camera.GetProjectionMatrix());
+            GLStateCache::ActiveTexture(GL_TEXTURE0);
+            GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
+            skyboxShader.setInt(skyboxTextureUniform, 0);
+
+            cubeRenderer->Draw(skyboxShader.getAttributeMask());
+        }).WriteColor(backbuffer);
 
-            cubeRenderer->Draw();
+        //Draw depth buffer directly to screen
+        if (showShadowMapOverlay) {
+            renderGraph->AddPass("ShadowMapOverlay", [&]() {
+                //GLStateCache::Disable(GL_DEPTH_TEST);
+                GLStateCache::CullFace(GL_BACK);
+
+                debugDepthShader.use();
+                debugDepthShader.setFloat(nearPlaneUniform, 0.01f);
+                debugDepthShader.setFloat(farPlaneUniform, 15.0f);
+
+                glm::vec3 scale = glm::vec3(0.25f);
+                scale.y *= ((float)SCR_WIDTH / SCR_HEIGHT);
+                debugDepthShader.setVec3(overlayScaleUniform, scale);
+                debugDepthShader.setVec3(overlayOffsetUniform, glm::vec3(-0.75f,1.0f - scale.y,0.0f));
+                GLStateCache::ActiveTexture(GL_TEXTURE0);
+                GLStateCache::BindTexture(GL_TEXTURE_2D, renderGraph->GetTexture(shadowMap));
+
+                quadRenderer->Draw(debugDepthShader.getAttributeMask());
+            }).Read(shadowMap).WriteColor(backbuffer);
         }
 
+        renderGraph->Compile();
+        renderGraph->Execute(gpuProfiler);
+        gpuProfiler->EndFrame();
 
-        //Draw depth buffer directly to screen
         {
-            //glDisable(GL_DEPTH_TEST);
-            glCullFace(GL_BACK);
+            CPU_PROFILE_ZONE("Swap buffers");
+            glfwSwapBuffers(window);
+        }
+        {
+            CPU_PROFILE_ZONE("Poll events");
+            glfwPollEvents();
+        }
+    }
+
+    if (CpuProfiler::IsCapturing())
+        writeCpuTrace();
+    delete gpuProfiler;
+    delete renderGraph;
+    delete occlusionQueries;
+    glfwTerminate();
+    JobSystem::Shutdown();
+    return 0;
+}
+
+void createScene()
+{
+    //Spinning cubes share a parent, so moving the group moves all of them
+    Entity cubeGroup = entities.Create();
+    entities.transforms.Add(cubeGroup, glm::vec3(0.0f, 1.0f, 0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+    const glm::vec3 cubePositions[] = { glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.5f, 0.5f, 1.0f) };
+    const glm::vec3 spinAxes[] = { glm::vec3(-0.5f, 0.2f, 0.0f), glm::vec3(0.0f, 0.2f, 0.5f), glm::vec3(0.0f, 0.2f, 0.5f) };
+    const float spinSpeeds[] = { 0.2f, 0.4f, 0.3f };
+    for (int i = 0; i < 3; i++)
+    {
+        //The cubes stand in for heavy meshes that are worth an occlusion query
+        Entity cube = addObject(cubeRenderer, cubeMaterial, cubeGroup, cubePositions[i], glm::vec3(0.5f), OBJECT_OCCLUSION_QUERY);
+        entities.spins.Add(cube, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), spinAxes[i], spinSpeeds[i]);
+    }
+
+    //Walls
+    addObject(cubeRenderer, wallMaterial, NULL_ENTITY, glm::vec3(1.0f, 1.0f, 2.0f), glm::vec3(2.0f, 2.0f, 0.5f), OBJECT_OCCLUDER);
+    addObject(cubeRenderer, tallWallMaterial, NULL_ENTITY, glm::vec3(1.0f, 1.5f, -2.0f), glm::vec3(2.0f, 3.0f, 0.5f), OBJECT_OCCLUDER);
+
+    //Ground plane
+    addObject(planeRenderer, groundMaterial, NULL_ENTITY, glm::vec3(0.0f), glm::vec3(5.0f));
+
+    sceneObjectCount = entities.renderables.GetCount();
+
+    //Light position drawn as a cube, moved every frame
+    lightGizmo = addObject(cubeRenderer, lightGizmoMaterial, NULL_ENTITY, glm::vec3(0.0f), glm::vec3(0.2f));
+    lightGizmoIndex = entities.renderables.IndexOf(lightGizmo);
+}
+
+void updateScene(float currentTime, const glm::vec3& lightPosition)
+{
+    CPU_PROFILE_ZONE("updateScene");
+    EntitySystems::UpdateSpin(entities, currentTime);
+    entities.transforms.SetPosition(lightGizmo, lightPosition);
+    EntitySystems::UpdateTransforms(entities);
+    EntitySystems::UpdateBounds(entities);
+
+    //Data derived from the world matrix only changes with it
+    const TransformPool& transforms = entities.transforms;
+    const std::vector<Entity>& objects = entities.renderables.GetEntities();
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        uint32_t transform = transforms.IndexOf(objects[i]);
+        if (!transforms.changed[transform])
+            continue;
+        ObjectData& data = objectData[i];
+        data.model = transforms.world[transform];
+        data.normalMatrix = glm::mat4(glm::transpose(glm::inverse(glm::mat3(data.model))));
+        objectBounds[i] = entities.bounds.world[entities.bounds.IndexOf(objects[i])];
+    }
+}
+
+//Creates an entity with a transform, a bounding box and something to draw
+Entity addObject(Primitive* primitive, Material* material, Entity parent, const glm::vec3& position, const glm::vec3& scale,
+    unsigned int flags)
+{
+    Entity entity = entities.Create();
+    entities.transforms.Add(entity, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), scale, parent);
+    entities.bounds.Add(entity, primitive->GetBounds());
+    entities.renderables.Add(entity, primitive, material, flags);
+    objectData.push_back(ObjectData());
+    objectBounds.push_back(AABB());
+    return entity;
+}
+
+void uploadObjectData(const glm::mat4& viewProjection, const glm::mat4& lightTransform)
+{
+    CPU_PROFILE_ZONE("uploadObjectData");
+    //Camera dependent matrices are computed here once instead of per vertex and per pass
+    //Packed on all threads, each object into its own slot. Only the upload needs the GL thread
+    objectDataStaging.resize(objectData.size() * objectDataStride);
+    JobSystem::ParallelFor(objectData.size(), OBJECTS_PER_JOB, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            ObjectData& data = objectData[i];
+            data.mvp = viewProjection * data.model;
+            data.lightMvp = lightTransform * data.model;
+            memcpy(&objectDataStaging[i * objectDataStride], &data, sizeof(ObjectData));
+        }
+    });
+    if (!objectDataStaging.empty())
+        objectDataBuffer->SetData(objectDataStaging.data(), objectDataStaging.size());
+}
 
-            debugDepthShader.use();
-            debugDepthShader.setFloat("near_plane", 0.01f);
-            debugDepthShader.setFloat("far_plane", 15.0f);
+void drawObject(size_t index, unsigned int attributeMask, GLuint conditionQuery)
+{
+    //Program and material are bound by the render queue
+    objectDataBuffer->BindRange(index * objectDataStride, sizeof(ObjectData));
+    entities.renderables.primitives[index]->Draw(attributeMask, conditionQuery);
+}
+
+void updateBounds()
+{
+    frustumCuller.Clear();
+    for (const AABB& bounds : objectBounds)
+        frustumCuller.Add(bounds);
+}
 
-            glm::vec3 scale = glm::vec3(0.25f);
-            scale.y *= ((float)SCR_WIDTH / SCR_HEIGHT);
-            debugDepthShader.setVec3("scale", scale);
-            debugDepthShader.setVec3("offset", glm::vec3(-0.75f,1.0f - scale.y,0.0f));
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, depthTexture);
+//Draws the visible occluders into the software depth buffer and removes the objects they hide from cameraVisible.
+//Call after frustum culling
+void cullOccluded(const glm::mat4& viewProjection)
+{
+    CPU_PROFILE_ZONE("cullOccluded");
+    occlusionCuller.BeginFrame(viewProjection);
+    const RenderablePool& renderables = entities.renderables;
+    for (size_t i = 0; i < renderables.GetCount(); i++)
+    {
+        if (cameraVisible[i] && (renderables.flags[i] & OBJECT_OCCLUDER))
+            occlusionCuller.AddOccluder(*renderables.primitives[i]->GetMeshData(), objectData[i].model);
+    }
+    occlusionCuller.Rasterize();
 
-            quadRenderer->Draw();
+    //Occluders would only be tested against themselves
+    occludedCount = 0;
+    for (size_t i = 0; i < renderables.GetCount(); i++)
+    {
+        if (cameraVisible[i] && !(renderables.flags[i] & OBJECT_OCCLUDER) && !occlusionCuller.IsVisible(objectBounds[i])) {
+            cameraVisible[i] = 0;
+            occludedCount++;
         }
-       
+    }
+    cameraVisibleCount -= occludedCount;
+}
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+//Queries the boxes of visible objects flagged OBJECT_OCCLUSION_QUERY against the depth drawn so far
+void issueOcclusionQueries(Shader& proxyShader, const glm::vec3& cameraPosition)
+{
+    CPU_PROFILE_ZONE("issueOcclusionQueries");
+    occlusionQueries->BeginQueries(proxyShader, *cubeRenderer, cameraPosition);
+    const RenderablePool& renderables = entities.renderables;
+    for (size_t i = 0; i < renderables.GetCount(); i++)
+    {
+        if (cameraVisible[i] && (renderables.flags[i] & OBJECT_OCCLUSION_QUERY))
+            occlusionQueries->Query(i, objectBounds[i]);
     }
+    occlusionQueries->EndQueries();
+}
 
-    glfwTerminate();
-    return 0;
+//Finds the objects able to shadow a receiver the camera sees. Call after the camera culling.
+//Casters are culled against the part of the shadow map volume around the visible receivers, open towards the light,
+//so casters off screen or in front of the near plane are kept
+void cullShadowCasters(const glm::mat4& lightView)
+{
+    CPU_PROFILE_ZONE("cullShadowCasters");
+    //Light view space box of the visible receivers
+    AABB receivers = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+    for (size_t i = 0; i < sceneObjectCount; i++)
+    {
+        if (!cameraVisible[i])
+            continue;
+        AABB box = objectBounds[i].Transform(lightView);
+        receivers.min = glm::min(receivers.min, box.min);
+        receivers.max = glm::max(receivers.max, box.max);
+    }
+
+    //Clamp to the shadow map. The light looks down -Z, so the farthest receiver is at -min.z
+    float left = std::max(receivers.min.x, -LIGHT_HALF_SIZE);
+    float right = std::min(receivers.max.x, LIGHT_HALF_SIZE);
+    float bottom = std::max(receivers.min.y, -LIGHT_HALF_SIZE);
+    float top = std::min(receivers.max.y, LIGHT_HALF_SIZE);
+    float farDistance = std::min(-receivers.min.z, LIGHT_FAR);
+    if (left >= right || bottom >= top || farDistance <= LIGHT_NEAR) {
+        //Nothing visible receives a shadow
+        lightVisible.assign(frustumCuller.GetCount(), 0);
+        return;
+    }
+
+    Frustum casterVolume = Frustum(glm::ortho(left, right, bottom, top, LIGHT_NEAR, farDistance) * lightView);
+    casterVolume.RemovePlane(Frustum::PLANE_NEAR);
+    frustumCuller.Cull(casterVolume, lightVisible);
 }
 
-void renderScene(const Shader& shader, float currentTime)
+//Distinct variant feature sets of the objects' materials, limited to passFeatures. Includes the light gizmo
+std::vector<unsigned int> getSceneFeatureSets(unsigned int passFeatures)
 {
-    glEnable(GL_DEPTH_TEST);
-
-    glDepthFunc(GL_LESS);
-
-    //Draw cubes
-    shader.setVec2("u_tile", glm::vec2(0.5f));
-
-    //Spinning cube 1 
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(0.0f, 1.0f, 0.0f));
-    model = glm::rotate(model, currentTime * 0.2f, glm::vec3(-0.5, 0.2f, 0.0f));
-    model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));
-    shader.setMat4("u_model", model);
-    cubeRenderer->Draw();
-
-    //Spinning cube 2
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(1.0f, 1.0f, 0.0f));
-    model = glm::rotate(model, currentTime * 0.4f, glm::vec3(0.0, 0.2f, 0.5f));
-    model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));
-    shader.setMat4("u_model", model);
-    cubeRenderer->Draw();
-
-    //Spinning cube 3
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(0.5f, 1.5f, 1.0f));
-    model = glm::rotate(model, currentTime * 0.3f, glm::vec3(0.0, 0.2f, 0.5f));
-    model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));
-    shader.setMat4("u_model", model);
-    cubeRenderer->Draw();
-
-    //Wall 1
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(1.0f, 1.0f, 2.0f));
-    model = glm::scale(model, glm::vec3(2.0f, 2.0f, 0.5f));
-    shader.setMat4("u_model", model);
-    shader.setVec2("u_tile", glm::vec2(2.0f));
-
-    cubeRenderer->Draw();
-
-    //Wall 2
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(1.0f, 1.5f, -2.0f));
-    model = glm::scale(model, glm::vec3(2.0f, 3.0f, 0.5f));
-    shader.setMat4("u_model", model);
-    shader.setVec2("u_tile", glm::vec2(2.0f,3.0f));
-
-    //glDrawArrays(GL_TRIANGLES, 0, 36);
-    cubeRenderer->Draw();
+    std::vector<unsigned int> featureSets;
+    for (const Material* material : entities.renderables.materials)
+    {
+        unsigned int features = material->GetShaderFeatures() & passFeatures;
+        if (std::find(featureSets.begin(), featureSets.end(), features) == featureSets.end())
+            featureSets.push_back(features);
+    }
+    return featureSets;
+}
 
-    //Ground plane
-    model = glm::mat4(1.0f);
-    model = glm::scale(model, glm::vec3(5.0f));
-    shader.setMat4("u_model", model);
-    shader.setFloat("u_tile", 5.0f);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, grassTexture);
-    shader.setInt("u_texture", 0);
-    planeRenderer->Draw();
+//Each object is drawn with the variant of variants its material needs, limited to passFeatures.
+//visible holds one entry per object, see FrustumCuller::Cull. Null submits everything
+//Records on all threads, each into its own entry of commandLists
+void submitScene(unsigned int pass, ShaderVariants& variants, unsigned int passFeatures, const glm::vec3& viewPosition, bool useMaterials,
+    const std::vector<uint8_t>* visible)
+{
+    CPU_PROFILE_ZONE("submitScene");
+    //Variants are looked up here since a missing one is compiled, which needs the GL thread. Workers only read the map
+    std::unordered_map<unsigned int, Shader*> shaders;
+    for (unsigned int features : getSceneFeatureSets(passFeatures))
+        shaders[features] = &variants.Get(features);
+
+    const RenderablePool& renderables = entities.renderables;
+    JobSystem::ParallelFor(sceneObjectCount, OBJECTS_PER_JOB, [&](size_t begin, size_t end) {
+        CommandList& list = commandLists[JobSystem::GetThreadIndex()];
+        for (size_t i = begin; i < end; i++)
+        {
+            if (visible != nullptr && !(*visible)[i])
+                continue;
+            Material* material = renderables.materials[i];
+            Shader* shader = shaders.find(material->GetShaderFeatures() & passFeatures)->second;
+            float depth = glm::distance(viewPosition, glm::vec3(objectData[i].model[3]));
+            list.Draw(pass, shader, renderables.primitives[i], useMaterials ? material : nullptr, i, depth);
+        }
+    });
+}
+
+//Submits everything recorded in commandLists to queue and clears the lists
+void mergeCommandLists(RenderQueue& queue)
+{
+    for (CommandList& list : commandLists)
+    {
+        recordedDraws += list.GetCount();
+        queue.Submit(list);
+        list.Clear();
+    }
+}
+
+void renderPass(RenderQueue& queue, unsigned int pass)
+{
+    CPU_PROFILE_ZONE("renderPass");
+    GLStateCache::Enable(GL_DEPTH_TEST);
+
+    GLStateCache::DepthFunc(GL_LESS);
+
+    PassStats& stats = passStats[pass];
+    stats = {};
+    queue.Execute(pass, [&stats, pass](const RenderCommand& command) {
+        //Queried objects are drawn only if last frame's query on their box passed
+        GLuint conditionQuery = 0;
+        if (pass == RENDER_PASS_MAIN && (entities.renderables.flags[command.objectIndex] & OBJECT_OCCLUSION_QUERY))
+            conditionQuery = occlusionQueries->GetCondition(command.objectIndex);
+        drawObject(command.objectIndex, command.shader->getAttributeMask(), conditionQuery);
+        stats.draws++;
+        stats.triangles += command.primitive->GetTriangleCount();
+    });
 }
 
 float getInputAxis(GLFWwindow* window, int positiveButton, int negativeButton) {
@@ -354,6 +843,7 @@ float getInputAxis(GLFWwindow* window, int positiveButton, int negativeButton) {
 
 void processInput(GLFWwindow* window)
 {
+    CPU_PROFILE_ZONE("processInput");
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
@@ -384,9 +874,10 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 }
 unsigned int loadTexture(const char* filePath)
 {
+    CPU_PROFILE_ZONE("loadTexture");
     unsigned int texture;
     glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    GLStateCache::BindTexture(GL_TEXTURE_2D, texture);
     // set the texture wrapping/filtering options (on the currently bound texture object)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -411,9 +902,10 @@ unsigned int loadTexture(const char* filePath)
 
 unsigned int loadCubemap(std::vector<std::string> faces)
 {
+    CPU_PROFILE_ZONE("loadCubemap");
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    GLStateCache::BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrChannels;
     for (size_t i = 0; i < faces.size(); i++)
@@ -441,6 +933,42 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     glViewport(0, 0, width, height);
 }
 
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (action != GLFW_PRESS)
+        return;
+    if (key == GLFW_KEY_L)
+        litPassFeatures ^= LIT_SHADOWS | LIT_PCF;
+    if (key == GLFW_KEY_O)
+        showShadowMapOverlay = !showShadowMapOverlay;
+    if (key == GLFW_KEY_T) {
+        if (CpuProfiler::IsCapturing()) {
+            writeCpuTrace();
+        }
+        else {
+            CpuProfiler::Start();
+            std::cout << "CPU trace started, press T again to stop" << std::endl;
+        }
+    }
+    if (key == GLFW_KEY_P) {
+        if (gpuProfiler->WriteCSV(GPU_TIMINGS_PATH))
+            std::cout << "GPU timings written to " << GPU_TIMINGS_PATH << std::endl;
+        else
+            std::cout << "ERROR::GPU_PROFILER::WRITE_FAILED\n" << GPU_TIMINGS_PATH << std::endl;
+    }
+}
+
+//Stops the running capture and saves it
+void writeCpuTrace()
+{
+    CpuProfiler::Stop();
+    if (CpuProfiler::WriteChromeTrace(CPU_TRACE_PATH))
+        std::cout << "CPU trace written to " << CPU_TRACE_PATH << ": " << CpuProfiler::GetEventCount() << " events, "
+            << CpuProfiler::GetDroppedCount() << " dropped" << std::endl;
+    else
+        std::cout << "ERROR::CPU_PROFILER::WRITE_FAILED\n" << CPU_TRACE_PATH << std::endl;
+}
+
 void mouse_scroll_callback(GLFWwindow* window, double xOffset, double yOffset)
 {
     camera.SetFov(camera.GetFov() - (float)yOffset * scrollSensitivity);
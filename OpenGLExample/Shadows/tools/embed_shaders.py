@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+# Embeds every file under shaders/ into src/EmbeddedShaders.h so the program does no shader file I/O at runtime.
+# Run from anywhere; paths are relative to this script. Runs as a pre-build step of Shadows.vcxproj.
+import os
+
+PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SHADER_DIR = os.path.join(PROJECT_DIR, "shaders")
+OUTPUT = os.path.join(PROJECT_DIR, "src", "EmbeddedShaders.h")
+EXTENSIONS = (".vert", ".frag", ".geom", ".glsl")
+# MSVC limits a single string literal piece to 16380 bytes, so long files are split into adjacent literals
+MAX_CHUNK = 8000
+DELIMITER = "GLSL"
+
+
+def collect():
+    shaders = []
+    for root, dirs, files in os.walk(SHADER_DIR):
+        dirs.sort()
+        for name in sorted(files):
+            if name.endswith(EXTENSIONS):
+                full = os.path.join(root, name)
+                rel = os.path.relpath(full, PROJECT_DIR).replace(os.sep, "/")
+                with open(full, "r", encoding="utf-8") as f:
+                    shaders.append((rel, f.read().replace("\r\n", "\n")))
+    return shaders
+
+
+def chunks(text):
+    chunk = ""
+    for line in text.splitlines(True):
+        if chunk and len(chunk) + len(line) > MAX_CHUNK:
+            yield chunk
+            chunk = ""
+        chunk += line
+    yield chunk
+
+
+def generate(shaders):
+    out = [
+        "// Generated by tools/embed_shaders.py from shaders/. Do not edit.",
+        "#pragma once",
+        "",
+        "struct EmbeddedShader {",
+        "    const char* path;",
+        "    const char* source;",
+        "};",
+        "",
+        "static const EmbeddedShader EMBEDDED_SHADERS[] = {",
+    ]
+    for path, text in shaders:
+        if ")" + DELIMITER + "\"" in text:
+            raise RuntimeError(path + " contains the raw string delimiter")
+        out.append('    { "' + path + '",')
+        for chunk in chunks(text):
+            out.append('R"' + DELIMITER + "(" + chunk + ")" + DELIMITER + '"')
+        out.append("    },")
+    out.append("};")
+    out.append("")
+    out.append("static const unsigned int NUM_EMBEDDED_SHADERS = sizeof(EMBEDDED_SHADERS) / sizeof(EMBEDDED_SHADERS[0]);")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    text = generate(collect())
+    # Only touch the header when something changed, to avoid needless rebuilds
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT, "r", encoding="utf-8") as f:
+            if f.read() == text:
+                return
+    with open(OUTPUT, "w", encoding="utf-8", newline="\n") as f:
+        f.write(text)
+    print("Embedded shaders written to " + OUTPUT)
+
+
+if __name__ == "__main__":
+    main()